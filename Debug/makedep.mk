@@ -8,9 +8,21 @@ gpio.c
 
 motor_control.c
 
-semaphores.c
-
 escape_robot.c
 
 sensors.c
 
+power.c
+
+events.c
+
+encoder.c
+
+battery.c
+
+restart.c
+
+profile.c
+
+telemetry.c
+
@@ -6,15 +6,47 @@
  */ 
 
 #include "adc.h"
-#include "semaphores.h"
+#include "events.h"
 #include "direction_defs.h"
 #include "sensors.h"
+#include "motor_control.h"
+#include "state_defs.h"
+#include "hal.h"
+#include "profile.h"
+#include "restart.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
-extern struct semaphore_t semaphores;
 extern uint16_t threat_distance[4];
-extern struct infrResults_t infrResults;
+extern volatile struct motorControl_t motorControl;
+extern volatile uint8_t state;
+extern volatile uint8_t headingDwell;
+
+#if ADC_REFLEX
+static uint16_t adcReflexThreshold = ADC_REFLEX_THRESHOLD;
+
+//sensors that are above the threshold, the reflex only fires when a sensor crosses it
+static uint8_t adcReflexAbove = 0;
+
+//number of times the reflex has fired
+volatile uint16_t adcReflexCount = 0;
+#endif
+
+#if ADC_USE_DMA
+//ping-pong sample blocks, DMA channel 0 fills block 0 while main reads block 1 and vice versa
+//each sweep holds the results of ADCB channels 0-3 which are in the same order as direction_defs.h
+static uint16_t adcDmaBlock[2][ADC_DMA_SWEEPS_PER_BLOCK][NUM_ADC_CHANNELS];
+
+//blocks completed by the DMA (only written by the DMA ISRs) and blocks read by main (only written by main)
+static volatile uint8_t adcDmaBlocksDone = 0;
+static uint8_t adcDmaBlocksRead = 0;
+
+//counts blocks that were overwritten before main read them
+volatile uint16_t adcDmaOverruns = 0;
+#else
+//channels that have finished converting in the current sweep, only used by the ADCB ISRs
+static uint8_t adcSweepChannels = 0;
+#endif
 
 void setup_ADCB()
 {
@@ -27,11 +59,19 @@ void setup_ADCB()
 	//set resolution to 12 bits
 	ADCB_CTRLB = ADC_RESOLUTION_12BIT_gc;
 	
-	//set interrupt for on complete and med level priority
-	ADCB_CH0_INTCTRL = 0x02;
-	ADCB_CH1_INTCTRL = 0x02;
-	ADCB_CH2_INTCTRL = 0x02;
-	ADCB_CH3_INTCTRL = 0x02;
+#if ADC_USE_DMA
+	//no interrupts on conversion complete, the DMA is triggered when all channels are done instead
+	ADCB_CH0_INTCTRL = 0x00;
+	ADCB_CH1_INTCTRL = 0x00;
+	ADCB_CH2_INTCTRL = 0x00;
+	ADCB_CH3_INTCTRL = 0x00;
+#else
+	//set interrupt for on complete and low level priority, the same level as the E1 ramp ISR so the reflex can't interrupt it
+	ADCB_CH0_INTCTRL = 0x01;
+	ADCB_CH1_INTCTRL = 0x01;
+	ADCB_CH2_INTCTRL = 0x01;
+	ADCB_CH3_INTCTRL = 0x01;
+#endif
 	
 	//set pre-scaler to divide by 4 (this was 512 for previous exp but 4 provides sufficient time and accuracy)
 	ADCB_PRESCALER = ADC_PRESCALER_DIV4_gc;
@@ -48,66 +88,219 @@ void setup_ADCB()
 	ADCB.CH2.CTRL = ADC_CH_INPUTMODE_SINGLEENDED_gc | ADC_CH_GAIN_1X_gc;
 	ADCB.CH3.CTRL = ADC_CH_INPUTMODE_SINGLEENDED_gc | ADC_CH_GAIN_1X_gc;
 
-	//results are contained in: ADCA.CHx.RES
+	//sweep channels 0-3 whenever event channel 1 fires (D1 overflow, see setup_timer_D1)
+	ADCB_EVCTRL = ADC_SWEEP_0123_gc | ADC_EVSEL_1234_gc | ADC_EVACT_SWEEP_gc;
+
+	//results are contained in: ADCB.CHx.RES
 	
 }
 
-//////////	Interrupts for ADC conversion completion, see sensors.c for a timing diagram
+//changes the raw sample that triggers the reflex, 0xFFFF turns it off
+void adc_set_reflex_threshold(uint16_t threshold)
+{
+#if ADC_REFLEX
+	adcReflexThreshold = threshold;
+#endif
+}
 
-ISR(ADCB_CH0_vect)
+//called from the low level ISR that receives each sample, see ADC_REFLEX in adc.h
+static void adc_reflex_check(uint8_t direction, uint16_t sample)
 {
-	if (infrResults.lCount < NUM_INF_SENS_MEAS)
+#if ADC_REFLEX
+	uint8_t direction_bm = 1 << direction;
+	
+	if(sample < adcReflexThreshold)
 	{
-		infrResults.left[infrResults.lCount] = ADCB_CH0_RES;
-		infrResults.lCount++;
+		adcReflexAbove &= ~direction_bm;
 	}
-	else
+	else if(!(adcReflexAbove & direction_bm))
 	{
-		semaphores.left_meas_done = 1;
+		adcReflexAbove |= direction_bm;
+		
+		//the motors are only the reflex's to drive while escaping, the other states (and the buttons in testing) own them
+		if(state != ESCAPING) return;
+		
+		adcReflexCount++;
+		
+		//stop right away if heading towards the threat, the reversed phases go out with the brake duty at the next PWM update
+		if(motorControl.direction == direction) motor_brake();
+		
+	#if ADC_REFLEX_ESCAPE
+		//sensor directions line up with the motor directions so the opposite one is RIGHT - direction,
+		//leave the spin alone
+		if(motorControl.direction <= RIGHT)
+		{
+			motor_set_direction(RIGHT - direction);
+			motor_set_target(motor_top_speed());
+			
+			//main keeps this heading for DIRECTION_DWELL_SWEEPS unless it is heading into a threat (see stabilize_heading()),
+			//so the filtered decision on the same sweep can't undo it straight away
+			headingDwell = 0;
+			RESTART_MARK_DIRTY();
+		}
+	#endif
 	}
+#endif
+}
+
+#if ADC_USE_DMA
+
+//sets up one of the two DMA channels used to copy a sweep of ADCB results into a sample block
+static void setup_DMA_channel(DMA_CH_t *ch, uint16_t *block)
+{
+	//one 8 byte burst (CH0RES to CH3RES) per trigger, repeat forever
+	ch->CTRLA = DMA_CH_BURSTLEN_8BYTE_gc | DMA_CH_SINGLE_bm | DMA_CH_REPEAT_bm;
+	ch->REPCNT = 0;
 	
+	//source goes back to CH0RES after every burst, destination goes back to the start of the block after every block
+	ch->ADDRCTRL = DMA_CH_SRCRELOAD_BURST_gc | DMA_CH_SRCDIR_INC_gc | DMA_CH_DESTRELOAD_TRANSACTION_gc | DMA_CH_DESTDIR_INC_gc;
 	
+	//trigger when all ADCB channels have completed their conversion
+	ch->TRIGSRC = DMA_CH_TRIGSRC_ADCB_CH4_gc;
+	
+	//one transaction is a full sample block
+	ch->TRFCNT = sizeof(adcDmaBlock[0]);
+	
+	HAL_DMA_SRCADDR(ch, &ADCB.CH0RES);
+	HAL_DMA_DESTADDR(ch, block);
+	
+	//interrupt once per block at low priority
+	ch->CTRLB = DMA_CH_TRNINTLVL_LO_gc;
 }
 
-ISR(ADCB_CH1_vect)
+//DMA channels 0 and 1 are used as a double buffer, when one fills a block the other takes over
+void setup_DMA_ADCB()
 {
-	if (infrResults.fCount < NUM_INF_SENS_MEAS)
-	{
-		infrResults.front[infrResults.fCount] = ADCB_CH1_RES;
-		infrResults.fCount++;
-	}
-	else
+	DMA.CTRL = 0;
+	DMA.CTRL = DMA_RESET_bm;
+	while(DMA.CTRL & DMA_RESET_bm) HAL_BUSY_WAIT();
+	
+	setup_DMA_channel(&DMA.CH0, &adcDmaBlock[0][0][0]);
+	setup_DMA_channel(&DMA.CH1, &adcDmaBlock[1][0][0]);
+	
+	DMA.CTRL = DMA_ENABLE_bm | DMA_DBUFMODE_CH01_gc;
+	
+	//only CH0 is enabled, the double buffer mode enables CH1 when CH0 is done
+	DMA.CH0.CTRLA |= DMA_CH_ENABLE_bm;
+}
+
+//called when a sample block is complete, this is the only interrupt per block in DMA mode
+static void adc_dma_block_done(uint8_t block)
+{
+	uint16_t (*sweeps)[NUM_ADC_CHANNELS] = adcDmaBlock[block];
+	
+	for(uint8_t i = 0; i < ADC_DMA_SWEEPS_PER_BLOCK; i++)
 	{
-		semaphores.front_meas_done = 1;
+		for(uint8_t direction = LEFT; direction <= RIGHT; direction++) adc_reflex_check(direction, sweeps[i][direction]);
 	}
 	
+	adcDmaBlocksDone++;
+	event_post(EVENT_QUEUE_LO, EVENT_SWEEP_DONE, block);
 }
 
-ISR(ADCB_CH2_vect)
+ISR(DMA_CH0_vect)
 {
-	//record results for back conversion
-	if (infrResults.bCount < NUM_INF_SENS_MEAS)
+	PROFILE_ISR_ENTER(PROFILE_DMA_CH0);
+	DMA.CH0.CTRLB |= DMA_CH_TRNIF_bm;
+	adc_dma_block_done(0);
+	PROFILE_ISR_EXIT(PROFILE_DMA_CH0);
+}
+
+ISR(DMA_CH1_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_DMA_CH1);
+	DMA.CH1.CTRLB |= DMA_CH_TRNIF_bm;
+	adc_dma_block_done(1);
+	PROFILE_ISR_EXIT(PROFILE_DMA_CH1);
+}
+
+//called by main for every EVENT_SWEEP_DONE. In DMA mode the sweeps in the block are added to the
+//infrared filters here, in ISR mode the conversion complete ISRs have already added them
+void adc_read_sweep(uint8_t block)
+{
+	uint16_t (*sweeps)[NUM_ADC_CHANNELS] = adcDmaBlock[block];
+	
+	//if the DMA has already finished the other block it is now writing over this one
+	if((uint8_t)(adcDmaBlocksDone - adcDmaBlocksRead) > 1) adcDmaOverruns++;
+	adcDmaBlocksRead++;
+	
+	for(uint8_t i = 0; i < ADC_DMA_SWEEPS_PER_BLOCK; i++)
 	{
-		infrResults.back[infrResults.bCount] = ADCB_CH2_RES;
-		infrResults.bCount++;
+		add_infSens_meas(LEFT, sweeps[i][LEFT]);
+		add_infSens_meas(FRONT, sweeps[i][FRONT]);
+		add_infSens_meas(BACK, sweeps[i][BACK]);
+		add_infSens_meas(RIGHT, sweeps[i][RIGHT]);
 	}
-	else
+}
+
+#else
+
+//DMA is not used in ISR mode
+void setup_DMA_ADCB()
+{
+}
+
+void adc_read_sweep(uint8_t block)
+{
+}
+
+//posts EVENT_SWEEP_DONE once all 4 channels of a sweep have finished converting
+static void adc_channel_done(uint8_t channel_bm)
+{
+	adcSweepChannels |= channel_bm;
+	
+	if(adcSweepChannels == 0x0F)
 	{
-		semaphores.back_meas_done = 1;
+		adcSweepChannels = 0;
+		event_post(EVENT_QUEUE_LO, EVENT_SWEEP_DONE, 0);
 	}
-		
+}
+
+//////////	Interrupts for ADC conversion completion, see sensors.c for a timing diagram
+
+ISR(ADCB_CH0_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_ADCB_CH0);
+	uint16_t sample = ADCB_CH0_RES;
+	
+	add_infSens_meas(LEFT, sample);
+	adc_reflex_check(LEFT, sample);
+	adc_channel_done(0x01);
+	PROFILE_ISR_EXIT(PROFILE_ADCB_CH0);
+}
+
+ISR(ADCB_CH1_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_ADCB_CH1);
+	uint16_t sample = ADCB_CH1_RES;
+	
+	add_infSens_meas(FRONT, sample);
+	adc_reflex_check(FRONT, sample);
+	adc_channel_done(0x02);
+	PROFILE_ISR_EXIT(PROFILE_ADCB_CH1);
+}
+
+ISR(ADCB_CH2_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_ADCB_CH2);
+	//record results for back conversion
+	uint16_t sample = ADCB_CH2_RES;
+	
+	add_infSens_meas(BACK, sample);
+	adc_reflex_check(BACK, sample);
+	adc_channel_done(0x04);
+	PROFILE_ISR_EXIT(PROFILE_ADCB_CH2);
 }
 
 ISR(ADCB_CH3_vect)
 {
-	if (infrResults.rCount < NUM_INF_SENS_MEAS)
-	{
-		infrResults.right[infrResults.rCount] = ADCB_CH3_RES;
-		infrResults.rCount++;
-	}
-	else
-	{
-		semaphores.right_meas_done = 1;
-	}
+	PROFILE_ISR_ENTER(PROFILE_ADCB_CH3);
+	uint16_t sample = ADCB_CH3_RES;
 	
-}
\ No newline at end of file
+	add_infSens_meas(RIGHT, sample);
+	adc_reflex_check(RIGHT, sample);
+	adc_channel_done(0x08);
+	PROFILE_ISR_EXIT(PROFILE_ADCB_CH3);
+}
+
+#endif /* ADC_USE_DMA */
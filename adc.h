@@ -9,8 +9,42 @@
 #ifndef ADC_H_
 #define ADC_H_
 
+#include <avr/io.h>
+
+//ADC acquisition mode. 1 uses DMA channels 0 and 1 in double buffer mode to move the ADCB results into
+//ping-pong sample blocks with no per-sample interrupts, 0 falls back on the per-channel conversion complete ISRs
+#ifndef ADC_USE_DMA
+#define ADC_USE_DMA 1
+#endif
+
+#define NUM_ADC_CHANNELS 4
+
+//number of sweeps in each DMA sample block, 1 gives main a new block after every sweep
+#define ADC_DMA_SWEEPS_PER_BLOCK 1
+
+//reflex layer, every sample is checked against a critical threshold in the ISR that receives it (the DMA block
+//ISR in DMA mode) and the motors are braked or sent straight away from the sensor without waiting for the filters
+//or main. Only acts in the escaping state. Runs at low level like the E1 ramp ISR so it can never interrupt a ramp step.
+//Worst case sensor to PWM: 1 sample period (100ms) waiting for the next sweep, <50us for the sweep, DMA and the
+//reflex itself, then up to 1 PWM period (20ms, or 50us with MOTOR_PWM_HF) before the brake duty and its reversed
+//phases are loaded together. The filtered path took up to NUM_INF_SENS_MEAS sweeps plus the ramp down.
+//An escape heading set by the reflex is held for the heading dwell time like one chosen by main
+#ifndef ADC_REFLEX
+#define ADC_REFLEX 1
+#endif
+
+//reflex action, 0 only brakes if the robot is moving towards the sensor, 1 also drives away from it
+#ifndef ADC_REFLEX_ESCAPE
+#define ADC_REFLEX_ESCAPE 1
+#endif
+
+//raw 12 bit sample that triggers the reflex, well above TRAPPED_INFRARED
+#define ADC_REFLEX_THRESHOLD 2000
 
 void setup_ADCB();
+void setup_DMA_ADCB();
+void adc_read_sweep(uint8_t block);
+void adc_set_reflex_threshold(uint16_t threshold);
 
 
 #endif /* ADC_H_ */
\ No newline at end of file
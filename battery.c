@@ -0,0 +1,152 @@
+/*
+ * battery.c
+ *
+ * Created: 10/17/2026 5:03:10 PM
+ *  Author: Clint
+ *
+ *	The pack voltage is measured by ADCA on the same D1 event that starts the sensor sweep, so it costs no
+ *	timer and no extra ISR per sample beyond the conversion complete. The voltage is filtered and mapped to one
+ *	of BATTERY_LEVELS levels, and whenever the level changes the motor top speed, kick and slew are set for it
+ *	and the change is added to batteryLog so the chosen limits can be read back with the debugger.
+ */
+
+#include "battery.h"
+#include "motor_control.h"
+#include "events.h"
+#include "profile.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#if BATTERY_ADAPT
+//pack voltage EMA in mV scaled by 2^BATTERY_EMA_SHIFT, 0 until the first measurement
+static uint32_t batteryFilter = 0;
+static volatile uint16_t batteryMv = 0;
+
+//level the current limits were chosen for, 0xFF until the first measurement
+static volatile uint8_t batteryLevel = 0xFF;
+
+//read these with the debugger, the latest entry is at batteryLogIndex - 1
+volatile struct batteryLimits_t batteryLog[BATTERY_LOG_SIZE];
+volatile uint8_t batteryLogIndex = 0;
+#endif
+
+void setup_ADCA_battery()
+{
+#if BATTERY_ADAPT
+	//PA1 is the divided pack voltage
+	PORTA_DIRCLR = 0x02;
+
+	//set voltage reference to 2.5v (AREFA) and resolution to 12 bits, same as the sensors
+	ADCA_REFCTRL = 0x20;
+	ADCA_CTRLB = ADC_RESOLUTION_12BIT_gc;
+	ADCA_PRESCALER = ADC_PRESCALER_DIV4_gc;
+
+	ADCA.CH0.MUXCTRL = ADC_CH_MUXPOS_PIN1_gc;
+	ADCA.CH0.CTRL = ADC_CH_INPUTMODE_SINGLEENDED_gc | ADC_CH_GAIN_1X_gc;
+
+	//convert channel 0 whenever event channel 1 fires (D1 overflow, see setup_timer_D1)
+	ADCA_EVCTRL = ADC_EVSEL_1234_gc | ADC_EVACT_CH0_gc;
+
+	//low level priority, the same level as the E1 ramp ISR so new limits can't land in the middle of a ramp step
+	ADCA_CH0_INTCTRL = 0x01;
+
+	ADCA_CTRLA = 0x01;
+#endif
+}
+
+#if BATTERY_ADAPT
+//linear interpolation between the weak and fresh limit for a level
+static uint16_t battery_limit(uint16_t weak, uint16_t fresh, uint8_t level)
+{
+	return weak + (uint16_t)(((int32_t)fresh - weak) * level / (BATTERY_LEVELS - 1));
+}
+
+//pack voltage at the bottom of a level
+static uint16_t battery_level_mv(uint8_t level)
+{
+	return BATTERY_WEAK_MV + (uint16_t)((uint32_t)(BATTERY_FRESH_MV - BATTERY_WEAK_MV) * level / (BATTERY_LEVELS - 1));
+}
+
+//level for a pack voltage, it only moves once the voltage is more than BATTERY_HYSTERESIS_MV into the next level
+static uint8_t battery_level(uint16_t mv, uint8_t level)
+{
+	if(level >= BATTERY_LEVELS)
+	{
+		level = 0;
+		while(level < BATTERY_LEVELS - 1 && mv >= battery_level_mv(level + 1)) level++;
+
+		return level;
+	}
+
+	while(level < BATTERY_LEVELS - 1 && mv >= battery_level_mv(level + 1) + BATTERY_HYSTERESIS_MV) level++;
+	while(level > 0 && mv + BATTERY_HYSTERESIS_MV < battery_level_mv(level)) level--;
+
+	return level;
+}
+
+//sets the motor limits for a level and logs them
+static void battery_apply_level(uint8_t level, uint16_t mv)
+{
+	volatile struct batteryLimits_t *entry = &batteryLog[batteryLogIndex];
+
+	entry->timestamp = event_timestamp();
+	entry->battery_mv = mv;
+	entry->level = level;
+	entry->top_ticks = battery_limit(BATTERY_WEAK_TOP_TICKS, BATTERY_FRESH_TOP_TICKS, level);
+	entry->kick_ticks = battery_limit(BATTERY_WEAK_KICK_TICKS, BATTERY_FRESH_KICK_TICKS, level);
+	entry->slew_ticks = battery_limit(BATTERY_WEAK_SLEW_TICKS, BATTERY_FRESH_SLEW_TICKS, level);
+	batteryLogIndex = (batteryLogIndex + 1) % BATTERY_LOG_SIZE;
+
+	motor_set_top_speed(entry->top_ticks);
+	motor_set_start_levels(entry->kick_ticks, entry->slew_ticks);
+
+	batteryLevel = level;
+}
+
+//called when the pack voltage conversion is done, once every sample period
+ISR(ADCA_CH0_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_ADCA_CH0);
+	int16_t counts = (int16_t)ADCA_CH0_RES - BATTERY_ADC_OFFSET;
+	uint16_t mv = (counts > 0) ? (uint16_t)(((uint32_t)counts * BATTERY_MV_FULL_SCALE) >> 12) : 0;
+
+	//start the filter on the first measurement so the limits are right straight away
+	if(!batteryFilter) batteryFilter = (uint32_t)mv << BATTERY_EMA_SHIFT;
+	else batteryFilter += mv - (batteryFilter >> BATTERY_EMA_SHIFT);
+
+	mv = (uint16_t)(batteryFilter >> BATTERY_EMA_SHIFT);
+	batteryMv = mv;
+
+	uint8_t level = battery_level(mv, batteryLevel);
+	if(level != batteryLevel) battery_apply_level(level, mv);
+	PROFILE_ISR_EXIT(PROFILE_ADCA_CH0);
+}
+#endif
+
+//returns the filtered pack voltage in mV, 0 when it isn't measured
+uint16_t get_battery_mv()
+{
+#if BATTERY_ADAPT
+	uint16_t mv;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		mv = batteryMv;
+	}
+
+	return mv;
+#else
+	return 0;
+#endif
+}
+
+//returns the level the motor limits are set for, 0 is the weakest pack and 0xFF means the pack hasn't been measured
+uint8_t get_battery_level()
+{
+#if BATTERY_ADAPT
+	return batteryLevel;
+#else
+	return 0xFF;
+#endif
+}
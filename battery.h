@@ -0,0 +1,67 @@
+/*
+ * battery.h
+ *
+ * Created: 10/17/2026 5:02:44 PM
+ *  Author: Clint
+ */
+
+
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+#include <avr/io.h>
+#include "motor_control.h"
+
+//set to 1 when the battery divider is fitted, the motor top speed, kick and slew are then adapted to the pack voltage.
+//0 keeps the fixed limits in motor_control.h, which are tuned for the worst case battery
+#ifndef BATTERY_ADAPT
+#define BATTERY_ADAPT 0
+#endif
+
+//the pack is measured on PA1 (ADCA channel 0) through a 30k/10k divider, against the same 2.5V AREFA as the sensors
+//so 4095 counts is 10V. Unsigned mode reads about 5% of full scale at 0V, which is taken off first
+#define BATTERY_MV_FULL_SCALE 10000UL
+#define BATTERY_ADC_OFFSET 200
+
+//each new measurement gets a weight of 1/2^BATTERY_EMA_SHIFT, the pack is measured every sample period (100ms)
+#define BATTERY_EMA_SHIFT 3
+
+//pack voltages the limits are tuned for, a 2S LiPo under load. Limits are interpolated in BATTERY_LEVELS
+//steps between the weak and fresh rows and only change once the voltage is BATTERY_HYSTERESIS_MV past a step
+#define BATTERY_WEAK_MV 6600
+#define BATTERY_FRESH_MV 8200
+#define BATTERY_LEVELS 8
+#define BATTERY_HYSTERESIS_MV 50
+
+//a weak pack sags and browns out if the motors start hard, a fresh one can start harder and run at full duty
+#define BATTERY_WEAK_TOP_TICKS 7000
+#define BATTERY_WEAK_KICK_TICKS 7000
+#define BATTERY_WEAK_SLEW_TICKS 250
+#define BATTERY_FRESH_TOP_TICKS MAX_SPEED_LIMIT_TICKS
+#define BATTERY_FRESH_KICK_TICKS MIN_SPEED_LIMIT_TICKS
+#define BATTERY_FRESH_SLEW_TICKS 1000
+
+//number of limit changes kept in the log
+#define BATTERY_LOG_SIZE 8
+
+//limits chosen for one battery level, saved in the log
+struct batteryLimits_t
+{
+	//C0 count when the limits were chosen (2us per tick)
+	uint16_t timestamp;
+
+	uint16_t battery_mv;
+	uint8_t level;
+
+	uint16_t top_ticks;
+	uint16_t kick_ticks;
+	uint16_t slew_ticks;
+
+};
+
+void setup_ADCA_battery();
+uint16_t get_battery_mv();
+uint8_t get_battery_level();
+
+
+#endif /* BATTERY_H_ */
@@ -0,0 +1,362 @@
+/*
+ * bench.c
+ *
+ * Created: 10/17/2026 7:32:10 PM
+ *  Author: Clint
+ *
+ *	Micro-benchmarks for the firmware hot paths, built for the ATxmega128A1 with the same options as the
+ *	Debug build. This main() replaces the firmware's (which is renamed to firmware_main()) and calls each
+ *	routine BENCH_CALLS times with interrupts off, using a different sensor reading every call.
+ *
+ *	Cycles are counted by TCC0 running straight off the peripheral clock, which is the CPU clock since the
+ *	system clock is never changed here, so the numbers don't depend on the clock setup. The cost of
+ *	reading the timer is measured first and taken off every call.
+ *
+ *	ISRs are called directly like functions. A real interrupt costs BENCH_ISR_EXTRA_CYCLES more than that,
+ *	see below, which is added to the ISR rows. The isr_entry_exit row is an empty ISR, the least any
+ *	interrupt can cost with its prologue and epilogue. The RETI at the end of each one sets the I flag again,
+ *	so it is cleared after every call. No interrupt level is enabled in the PMIC here, so none can get in before.
+ *
+ *	The results are left in benchResults[] and bench_done() is called, bench.gdb reads them from there.
+ *	See the Makefile for how to run it.
+ *
+ *	The same file also builds against the host headers (HOST_BUILD, make host). The routines then run on the
+ *	PC with the sim's registers and are timed in nanoseconds with the monotonic clock, kept in 32 bits, and
+ *	bench_done() prints the rows itself. Those numbers are only good for comparing one host run with another.
+ */
+
+#include "sensors.h"
+#include "motor_control.h"
+#include "events.h"
+#include "adc.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#ifdef HOST_BUILD
+#include <stdio.h>
+#include <time.h>
+#endif
+
+#define BENCH_CALLS 64
+#define MAX_BENCH_RESULTS 16
+
+//a real interrupt takes 5 cycles to respond and 3 for the JMP in the vector table, where calling the
+//ISR directly takes a 4 cycle CALL. RETI and RET both take 5 cycles with the 3 byte PC of the 128A1
+#ifdef HOST_BUILD
+#define BENCH_ISR_EXTRA_CYCLES 0
+#else
+#define BENCH_ISR_EXTRA_CYCLES (5 + 3 - 4)
+#endif
+
+#ifndef BENCH_CONFIG
+#define BENCH_CONFIG "default"
+#endif
+
+//TCC0 cycles on the target, 32 bit ns on the host so a call longer than 65us doesn't wrap
+#ifdef HOST_BUILD
+typedef uint32_t benchTicks_t;
+#else
+typedef uint16_t benchTicks_t;
+#endif
+
+struct benchResult_t
+{
+	const char *name;
+	const char *kind;
+	uint16_t calls;
+	benchTicks_t min;
+	benchTicks_t max;
+	uint32_t total;
+};
+
+//read by bench.gdb
+const char benchConfig[] __attribute__((used)) = BENCH_CONFIG;
+struct benchResult_t benchResults[MAX_BENCH_RESULTS] __attribute__((used));
+volatile uint8_t benchCount __attribute__((used)) = 0;
+
+//cycles taken by BENCH_TIME() with nothing in it
+static benchTicks_t benchOverhead = 0;
+static uint16_t benchLfsr = 0xACE1;
+
+//global variables and functions declared in escape_robot.c
+extern volatile uint16_t threat_distance[4];
+extern volatile struct motorControl_t motorControl;
+void determine_threat_order();
+uint8_t check_for_trapped();
+
+//ISRs defined in adc.c and motor_control.c
+#if ADC_USE_DMA
+void DMA_CH0_vect(void);
+#else
+void ADCB_CH0_vect(void);
+void ADCB_CH1_vect(void);
+void ADCB_CH2_vect(void);
+void ADCB_CH3_vect(void);
+#endif
+void TCE1_OVF_vect(void);
+
+#ifdef HOST_BUILD
+//the sim's TCC0 only counts while the firmware sleeps, so the host build times with the PC's clock in ns
+static uint32_t bench_ticks()
+{
+	struct timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+#define BENCH_TICKS() bench_ticks()
+#else
+#define BENCH_TICKS() TCC0_CNT
+#endif
+
+//times one statement in TCC0 ticks (ns on the host), the barriers stop the compiler moving any of it outside the two reads
+#define BENCH_TIME(cycles, statement) do { \
+	benchTicks_t start = BENCH_TICKS(); \
+	__asm__ __volatile__("" ::: "memory"); \
+	statement; \
+	__asm__ __volatile__("" ::: "memory"); \
+	cycles = BENCH_TICKS() - start; \
+	} while (0)
+
+//times an ISR called directly, then clears the I flag its RETI set
+#define BENCH_ISR(cycles, vector) do { \
+	BENCH_TIME(cycles, vector()); \
+	cli(); \
+	} while (0)
+
+//gdb stops here once every benchmark has run, the host build prints the same rows as bench.gdb
+void __attribute__((noinline)) bench_done()
+{
+#ifdef HOST_BUILD
+	for(uint8_t i = 0; i < benchCount; i++)
+	{
+		struct benchResult_t *result = &benchResults[i];
+		
+		printf("%s\t%s\t%s\t%u\t%u\t%u\t%u\n", benchConfig, result->name, result->kind, result->calls,
+			(unsigned)result->min, (unsigned)(result->total / result->calls), (unsigned)result->max);
+	}
+#else
+	__asm__ __volatile__("");
+#endif
+}
+
+//reference for the interrupt entry and exit cost, this vector isn't used by the firmware
+ISR(PORTR_INT0_vect)
+{
+}
+
+//12 bit pseudo random sensor reading
+static uint16_t bench_reading()
+{
+	benchLfsr = (benchLfsr >> 1) ^ (-(benchLfsr & 1) & 0xB400);
+	
+	return benchLfsr & 0x0FFF;
+}
+
+//puts a new reading into every sensor filter and threat tracker, so each call sees different data
+static void bench_new_sweep()
+{
+	for(uint8_t direction = LEFT; direction <= RIGHT; direction++) add_infSens_meas(direction, bench_reading());
+	
+	//this also updates the threat trackers
+	set_infrSens_avg_to_threatDist();
+}
+
+static struct benchResult_t *bench_begin(const char *name, const char *kind)
+{
+	struct benchResult_t *result = &benchResults[benchCount++];
+	
+	result->name = name;
+	result->kind = kind;
+	result->calls = 0;
+	result->min = (benchTicks_t)~0;
+	result->max = 0;
+	result->total = 0;
+	
+	return result;
+}
+
+static void bench_record(struct benchResult_t *result, benchTicks_t cycles, uint16_t extra)
+{
+	//on the host a call can come in under the lowest overhead measured
+	cycles = (cycles > benchOverhead ? cycles - benchOverhead : 0) + extra;
+	
+	result->calls++;
+	result->total += cycles;
+	if(cycles < result->min) result->min = cycles;
+	if(cycles > result->max) result->max = cycles;
+}
+
+static void bench_timer_start()
+{
+	TCC0_CTRLA = 0;
+	TCC0_CNT = 0;
+	TCC0_PER = 0xFFFF;
+	TCC0_CTRLA = TC_CLKSEL_DIV1_gc;
+	
+	//cost of the timer reads themselves, the lowest of a few tries
+	benchOverhead = (benchTicks_t)~0;
+	for(uint8_t i = 0; i < 8; i++)
+	{
+		benchTicks_t cycles;
+		
+		BENCH_TIME(cycles, );
+		if(cycles < benchOverhead) benchOverhead = cycles;
+	}
+}
+
+//////////	benchmarks
+
+static void bench_functions()
+{
+	struct benchResult_t *result;
+	benchTicks_t cycles;
+	
+	result = bench_begin("calc_avg", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		bench_new_sweep();
+		BENCH_TIME(cycles, calc_avg(i & 0x03));
+		bench_record(result, cycles, 0);
+	}
+	
+	result = bench_begin("set_infrSens_avg_to_threatDist", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		bench_new_sweep();
+		BENCH_TIME(cycles, set_infrSens_avg_to_threatDist());
+		bench_record(result, cycles, 0);
+	}
+	
+	result = bench_begin("determine_threat_order", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		bench_new_sweep();
+		BENCH_TIME(cycles, determine_threat_order());
+		bench_record(result, cycles, 0);
+	}
+	
+	result = bench_begin("check_for_trapped", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		bench_new_sweep();
+		BENCH_TIME(cycles, check_for_trapped());
+		bench_record(result, cycles, 0);
+	}
+	
+	result = bench_begin("threat_led_ticks", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		uint16_t reading = bench_reading();
+		
+		BENCH_TIME(cycles, threat_led_ticks(reading));
+		bench_record(result, cycles, 0);
+	}
+	
+#if THREAT_LED_USE_SIGMOID
+	result = bench_begin("calculate_sigmoid", "func");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		uint16_t reading = bench_reading();
+		
+		BENCH_TIME(cycles, calculate_sigmoid(reading));
+		bench_record(result, cycles, 0);
+	}
+#endif
+}
+
+static void bench_isrs()
+{
+	struct benchResult_t *result;
+	benchTicks_t cycles;
+	
+	result = bench_begin("isr_entry_exit", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		BENCH_ISR(cycles, PORTR_INT0_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+	
+	//the samples are whatever the idle ADC (or the untouched DMA block) holds, so the reflex check never fires here
+#if ADC_USE_DMA
+	result = bench_begin("DMA_CH0_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		//the block done ISR posts an event every call, don't let the queue fill up
+		initialize_events();
+		BENCH_ISR(cycles, DMA_CH0_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+#else
+	result = bench_begin("ADCB_CH0_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		initialize_events();
+		BENCH_ISR(cycles, ADCB_CH0_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+	
+	result = bench_begin("ADCB_CH1_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		initialize_events();
+		BENCH_ISR(cycles, ADCB_CH1_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+	
+	result = bench_begin("ADCB_CH2_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		initialize_events();
+		BENCH_ISR(cycles, ADCB_CH2_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+	
+	//the other channels are run first without being timed, so every timed call completes the sweep and posts EVENT_SWEEP_DONE
+	result = bench_begin("ADCB_CH3_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		initialize_events();
+		ADCB_CH0_vect();
+		ADCB_CH1_vect();
+		ADCB_CH2_vect();
+		cli();
+		BENCH_ISR(cycles, ADCB_CH3_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+#endif
+	
+	//ramp ISR, with the target flipping between stopped and top speed so there is always something to ramp
+	result = bench_begin("TCE1_OVF_vect", "isr");
+	for(uint8_t i = 0; i < BENCH_CALLS; i++)
+	{
+		initialize_events();
+		if(!(i & 0x0F)) motor_set_target((i & 0x10) ? 0 : motor_top_speed());
+		BENCH_ISR(cycles, TCE1_OVF_vect);
+		bench_record(result, cycles, BENCH_ISR_EXTRA_CYCLES);
+	}
+}
+
+int main(void)
+{
+	cli();
+	
+	initialize_events();
+	initialize_motorControl();
+	initialize_threat_distances();
+	reset_infSens();
+	
+	bench_timer_start();
+	
+	bench_functions();
+	bench_isrs();
+	
+	bench_done();
+	
+#ifdef HOST_BUILD
+	return 0;
+#else
+	while(1);
+#endif
+}
@@ -14,6 +14,16 @@
 #define BACK 2
 #define RIGHT 3
 
+//the robot keeps its heading unless the new furthest threat reads at least DIRECTION_HYSTERESIS lower,
+//and it has held the heading for DIRECTION_DWELL_SWEEPS sweeps (500ms at the default sample period)
+#define DIRECTION_HYSTERESIS 100
+#define DIRECTION_DWELL_SWEEPS 5
+
+//set to 1 to let the robot escape diagonally (8 directions) using the motor mixer, 0 only uses the 4 directions
+#ifndef ESCAPE_DIAGONALS
+#define ESCAPE_DIAGONALS 1
+#endif
+
 
 
 #endif /* DIRECTION_DEFS_H_ */
\ No newline at end of file
@@ -0,0 +1,226 @@
+/*
+ * encoder.c
+ *
+ * Created: 10/17/2026 4:31:25 PM
+ *  Author: Clint
+ *
+ *	Wheel encoders are decoded in hardware. Each encoder's A/B pins are routed through a quadrature decoding
+ *	event channel to a timer, which counts up or down as the wheel turns without any interrupts. The E1 ramp ISR
+ *	calls encoder_sample() every ramp period (40ms) to turn the counts into wheel speeds and odometry, then
+ *	speed_control() runs a PI controller per wheel to find the duty that gives the ramped speed.
+ *
+ *	Event channel	Timer	Pins		Wheel
+ *	0				TCF0	PF0/PF1		LF
+ *	2				TCF1	PF2/PF3		LR
+ *	4				TCC1	PF4/PF5		RR
+ *	-				-		-			RF, worked out from the other 3
+ *
+ *	Without MOTOR_CLOSED_LOOP none of this is set up, PF0-PF5, event channels 0, 2 and 4 and TCF0, TCF1 and
+ *	TCC1 are left as they come out of reset for other uses (ISR_PROFILING runs TCF1).
+ */
+
+#include "encoder.h"
+#include "motor_control.h"
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#if MOTOR_CLOSED_LOOP
+//count of each encoder timer at the last sample
+static uint16_t encoderLastCount[NUM_ENCODERS];
+
+static volatile struct speedControl_t speedControl;
+static volatile struct odometry_t odometry;
+
+void setup_QDEC_encoders()
+{
+	//encoder pins are inputs, QDEC needs them to sense level rather than edges
+	ENCODER_PORT.DIRCLR = 0x3F;
+	PORTCFG.MPCMASK = 0x3F;
+	ENCODER_PORT.PIN0CTRL = PORT_ISC_LEVEL_gc;
+	
+	//route each A pin (the B pin is the next one up) to a quadrature decoding event channel, filtered over 2 samples
+	EVSYS_CH0MUX = EVSYS_CHMUX_PORTF_PIN0_gc;
+	EVSYS_CH0CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_2SAMPLES_gc;
+	EVSYS_CH2MUX = EVSYS_CHMUX_PORTF_PIN2_gc;
+	EVSYS_CH2CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_2SAMPLES_gc;
+	EVSYS_CH4MUX = EVSYS_CHMUX_PORTF_PIN4_gc;
+	EVSYS_CH4CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_2SAMPLES_gc;
+	
+	//timers count the full 16 bits up and down, the difference between samples is the distance travelled
+	TCF0_CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH0_gc;
+	TCF0_PER = 0xFFFF;
+	TCF0_CTRLA = TC_CLKSEL_DIV1_gc;
+	
+	TCF1_CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH2_gc;
+	TCF1_PER = 0xFFFF;
+	TCF1_CTRLA = TC_CLKSEL_DIV1_gc;
+	
+	TCC1_CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH4_gc;
+	TCC1_PER = 0xFFFF;
+	TCC1_CTRLA = TC_CLKSEL_DIV1_gc;
+	
+	encoderLastCount[MOTOR_LF] = TCF0_CNT;
+	encoderLastCount[MOTOR_LR] = TCF1_CNT;
+	encoderLastCount[MOTOR_RR] = TCC1_CNT;
+	
+	speed_control_reset();
+	reset_odometry();
+}
+#else
+//open loop doesn't read the encoders, so the pins, event channels and timers aren't touched
+void setup_QDEC_encoders()
+{
+}
+#endif
+
+#if MOTOR_CLOSED_LOOP
+//counts since the last sample for one encoder, positive when its wheel is going forwards
+static int16_t encoder_delta(uint8_t ch, uint16_t count)
+{
+	int16_t delta = (int16_t)(count - encoderLastCount[ch]);
+	
+	encoderLastCount[ch] = count;
+	
+	return (ENCODER_INVERT_MASK & (1 << ch)) ? -delta : delta;
+}
+#endif
+
+//called from the E1 ramp ISR once per ramp period. phase is the PORTD_OUT phase pattern the motors were driven
+//with, a wheel turning against its phase bit has a negative speed
+void encoder_sample(uint8_t phase)
+{
+#if MOTOR_CLOSED_LOOP
+	int16_t counts[NUM_MOTORS];
+	
+	counts[MOTOR_LF] = encoder_delta(MOTOR_LF, TCF0_CNT);
+	counts[MOTOR_LR] = encoder_delta(MOTOR_LR, TCF1_CNT);
+	counts[MOTOR_RR] = encoder_delta(MOTOR_RR, TCC1_CNT);
+	
+	//RF has no encoder, its speed isn't measured but derived from LF + RF = LR + RR, so a slipping wheel shows up as RF
+	counts[MOTOR_RF] = counts[MOTOR_LR] + counts[MOTOR_RR] - counts[MOTOR_LF];
+	
+	//inverse of the motor_mix() equations
+	odometry.x += counts[MOTOR_LF] + counts[MOTOR_LR] + counts[MOTOR_RR] + counts[MOTOR_RF];
+	odometry.y += -counts[MOTOR_LF] + counts[MOTOR_LR] - counts[MOTOR_RR] + counts[MOTOR_RF];
+	odometry.rotation += -counts[MOTOR_LF] - counts[MOTOR_LR] + counts[MOTOR_RR] + counts[MOTOR_RF];
+	
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		int32_t speed = ((int32_t)counts[ch] * ENCODER_SPEED_SCALE_Q16) >> 16;
+		
+		//phase bit clear drives the wheel backwards, speeds are measured in the direction the wheel is being driven
+		if(!(phase & MOTOR_PHASE_bm(ch))) speed = -speed;
+		
+		speedControl.speed_ticks[ch] = (int16_t)speed;
+	}
+#endif
+}
+
+//PI controller, works out the duty each motor needs to reach its ramped speed from the last encoder sample.
+//Called from the E1 ramp ISR after encoder_sample(), target_ticks and duty_ticks are indexed by motor channel
+void speed_control(const volatile uint16_t *target_ticks, uint16_t *duty_ticks)
+{
+#if MOTOR_CLOSED_LOOP
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		uint16_t target = target_ticks[ch];
+		
+		//a stopped motor is left unpowered rather than held at 0 speed
+		if(!target)
+		{
+			speedControl.integral[ch] = 0;
+			speedControl.duty_ticks[ch] = 0;
+			duty_ticks[ch] = 0;
+			continue;
+		}
+		
+		int32_t error = (int32_t)target - speedControl.speed_ticks[ch];
+		int32_t integral = speedControl.integral[ch] + error * SPEED_KI_Q8;
+		
+		if(integral > ((int32_t)SPEED_INTEGRAL_LIMIT_TICKS << 8)) integral = (int32_t)SPEED_INTEGRAL_LIMIT_TICKS << 8;
+		if(integral < -((int32_t)SPEED_INTEGRAL_LIMIT_TICKS << 8)) integral = -((int32_t)SPEED_INTEGRAL_LIMIT_TICKS << 8);
+		
+		int32_t duty = target + ((error * SPEED_KP_Q8) >> 8) + (integral >> 8);
+		
+		//only keep the new integral if the output isn't saturated in the same direction, so it can't wind up
+		if(duty > MAX_TICKS_MOTOR)
+		{
+			duty = MAX_TICKS_MOTOR;
+			if(integral > speedControl.integral[ch]) integral = speedControl.integral[ch];
+		}
+		else if(duty < 0)
+		{
+			duty = 0;
+			if(integral < speedControl.integral[ch]) integral = speedControl.integral[ch];
+		}
+		
+		speedControl.integral[ch] = integral;
+		speedControl.duty_ticks[ch] = (uint16_t)duty;
+		duty_ticks[ch] = (uint16_t)duty;
+	}
+#else
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++) duty_ticks[ch] = target_ticks[ch];
+#endif
+}
+
+//clears the integral terms, used when the motors are braked so the controllers don't fight the stop afterwards
+void speed_control_reset()
+{
+#if MOTOR_CLOSED_LOOP
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+		{
+			speedControl.speed_ticks[ch] = 0;
+			speedControl.integral[ch] = 0;
+			speedControl.duty_ticks[ch] = 0;
+		}
+	}
+#endif
+}
+
+//returns the speed of a wheel over the last ramp period in MAX_TICKS_MOTOR ticks, 0 without encoders
+int16_t get_wheel_speed(uint8_t ch)
+{
+#if MOTOR_CLOSED_LOOP
+	int16_t speed;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		speed = speedControl.speed_ticks[ch];
+	}
+	
+	return speed;
+#else
+	return 0;
+#endif
+}
+
+//copies the distance travelled since the odometry was reset, see struct odometry_t
+void get_odometry(struct odometry_t *result)
+{
+#if MOTOR_CLOSED_LOOP
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		result->x = odometry.x;
+		result->y = odometry.y;
+		result->rotation = odometry.rotation;
+	}
+#else
+	result->x = 0;
+	result->y = 0;
+	result->rotation = 0;
+#endif
+}
+
+void reset_odometry()
+{
+#if MOTOR_CLOSED_LOOP
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		odometry.x = 0;
+		odometry.y = 0;
+		odometry.rotation = 0;
+	}
+#endif
+}
@@ -0,0 +1,77 @@
+/*
+ * encoder.h
+ *
+ * Created: 10/17/2026 4:31:08 PM
+ *  Author: Clint
+ */
+
+
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+#include <avr/io.h>
+#include "motor_control.h"
+
+//set to 1 when the wheel encoders are fitted, the ramp ISR then ramps wheel speeds and a PI controller per wheel
+//sets the duty needed to reach them. 0 is the original open loop duty control
+#ifndef MOTOR_CLOSED_LOOP
+#define MOTOR_CLOSED_LOOP 0
+#endif
+
+//the ATxmega128A1 only has quadrature decoders on event channels 0, 2 and 4, so only LF, LR and RR have encoders.
+//A mecanum robot only moves in 3 axes, so as long as the wheels don't slip LF + RF = LR + RR and RF is worked out from the others
+//encoder A/B inputs are on port F, LF on PF0/PF1 (TCF0), LR on PF2/PF3 (TCF1) and RR on PF4/PF5 (TCC1).
+//They are only set up with MOTOR_CLOSED_LOOP, the open loop build leaves them free
+#define ENCODER_PORT PORTF
+#define NUM_ENCODERS 3
+
+//encoder counts (4 per encoder line) in one ramp period (40ms) with the wheel at full speed, sets what MAX_TICKS_MOTOR means as a speed
+#define ENCODER_MAX_SPEED_COUNTS 240
+
+//encoder counts to MAX_TICKS_MOTOR ticks as a 16 bit fraction so the scaling is a multiply and a shift
+#define ENCODER_SPEED_SCALE_Q16 (((uint32_t)MAX_TICKS_MOTOR << 16) / ENCODER_MAX_SPEED_COUNTS)
+
+//set bit n if encoder n counts down when its wheel drives forwards
+#define ENCODER_INVERT_MASK 0x00
+
+//PI gains as 1/256ths, the proportional gain acts on the speed error and the integral gain on the error added up
+//every ramp period. The speed ramp already feeds forward the duty, so the controller only has to correct it
+#define SPEED_KP_Q8 128
+#define SPEED_KI_Q8 32
+
+//most duty the integral term can add or take away, stops it winding up while a wheel is stalled
+#define SPEED_INTEGRAL_LIMIT_TICKS (MAX_TICKS_MOTOR / 2)
+
+struct speedControl_t
+{
+	//speed of each wheel over the last ramp period in MAX_TICKS_MOTOR ticks, positive is forwards
+	int16_t speed_ticks[NUM_MOTORS];
+	
+	//error added up by the integral term in 1/256 ticks
+	int32_t integral[NUM_MOTORS];
+	
+	//duty written to the PWM by the controller
+	uint16_t duty_ticks[NUM_MOTORS];
+	
+};
+
+//distance travelled in the robot's own frame since the odometry was reset. Each axis adds up the QDEC counts of all
+//four wheels with the motor_mix() signs, so 4 units is one encoder count (a quarter of an encoder line) of wheel travel.
+//x is forwards, y is to the left and rotation is counter clockwise, rotation is wheel travel so it depends on the wheel base
+struct odometry_t
+{
+	int32_t x;
+	int32_t y;
+	int32_t rotation;
+};
+
+void setup_QDEC_encoders();
+void encoder_sample(uint8_t phase);
+void speed_control(const volatile uint16_t *target_ticks, uint16_t *duty_ticks);
+void speed_control_reset();
+int16_t get_wheel_speed(uint8_t ch);
+void get_odometry(struct odometry_t *odometry);
+void reset_odometry();
+
+
+#endif /* ENCODER_H_ */
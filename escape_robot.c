@@ -16,9 +16,11 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <math.h>
 #include <util/delay.h>
-#include "semaphores.h"
+#include <util/atomic.h>
+#include "events.h"
 #include "led_definitions.h"
 #include "adc.h"
 #include "sensors.h"
@@ -26,6 +28,13 @@
 #include "motor_control.h"
 #include "gpio.h"
 #include "state_defs.h"
+#include "power.h"
+#include "encoder.h"
+#include "battery.h"
+#include "restart.h"
+#include "hal.h"
+#include "profile.h"
+#include "telemetry.h"
 
 
 ///////////////////  global variables
@@ -33,18 +42,23 @@ volatile unsigned long sClk, pClk;
 volatile uint16_t threat_distance[4] = {0, 0, 0, 0};
 volatile uint8_t closestThreat = 0;
 volatile uint8_t furthestThreat = 0;
-volatile struct semaphore_t semaphores;
 volatile struct motorControl_t motorControl;
 volatile struct infrResults_t infrResults;
-volatile uint8_t state = 0;		//this is used to hold the current state of the robot
+struct threatTrack_t threatTrack;
+volatile uint8_t headingDwell = 0;		//sweeps since the heading last changed, see stabilize_heading()
+volatile uint8_t state = 0;		//this is used to hold the current state of the robot, only changed by dispatch_event()
 
 
 //Prototypes
 void set_Clock_32MHz();
 void initialize_threat_distances();
 void determine_threat_order();
+void stabilize_heading();
+void head_towards_free_space();
 void move_away_from_threat();
 uint8_t check_for_trapped();
+uint8_t dispatch_event(uint8_t type, uint16_t payload, uint16_t timestamp);
+void resume_after_restart();
 
 
 void set_Clock_32MHz()
@@ -57,29 +71,96 @@ void determine_threat_order()
 {
 	uint16_t closestThreat_meas = 0;
 	uint16_t furthestThreat_meas = 0xFFFF;
+	uint16_t closestThreat_ttc = TTC_NEVER;
+	uint16_t furthestThreat_ttc = 0;
 	
-	//check each direction to see which distance is closest or furthest
+	//check each direction to see which threat will reach the robot first or last
+	//threats that aren't approaching all have the same time to contact so they fall back on the distance
 	//note that threat distance is the value returned by the ADC from infrared sensors, high = closer,  low = further away
 	for(int i = LEFT; i <= RIGHT; i++)
 	{
+		uint16_t ttc = time_to_contact((uint8_t)i);
+		
 		//closest threat is used to decide what to move away from
-		if (threat_distance[i] > closestThreat_meas )
+		if (ttc < closestThreat_ttc || (ttc == closestThreat_ttc && threat_distance[i] > closestThreat_meas))
 		{
 			closestThreat = (uint8_t)i;
 			closestThreat_meas = threat_distance[i];
+			closestThreat_ttc = ttc;
 		}
 		
 		//furthest threat used to decide which direction to go
-		if (threat_distance[i] < furthestThreat_meas )
+		if (ttc > furthestThreat_ttc || (ttc == furthestThreat_ttc && threat_distance[i] < furthestThreat_meas))
 		{
 			furthestThreat = (uint8_t)i;
 			furthestThreat_meas = threat_distance[i];
+			furthestThreat_ttc = ttc;
 		}
 			
 	}
 			
 }
 
+//changing direction costs a full ramp down and up, so keep the current heading when the new furthest threat is only
+//slightly better or the heading was only just chosen. Heading into the closest or a fast approaching threat always changes
+void stabilize_heading()
+{
+	uint8_t heading = motorControl.direction;
+	
+	//the reflex in the ADC ISRs resets it as well
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (headingDwell < 0xFF) headingDwell++;
+	}
+	
+	//spinning or already going the right way
+	if (heading > RIGHT || heading == furthestThreat) return;
+	
+	uint8_t dangerous = (heading == closestThreat) || (time_to_contact(heading) <= ESCAPE_TTC_SWEEPS);
+	uint8_t better = threat_distance[heading] > threat_distance[furthestThreat] + DIRECTION_HYSTERESIS;
+	
+	//changing direction is free when the robot isn't moving
+	uint8_t stopped = motor_ramp_done() && !motorControl.speed_ticks;
+	
+	if (dangerous || stopped || (better && headingDwell >= DIRECTION_DWELL_SWEEPS))
+	{
+		headingDwell = 0;
+	}
+	else
+	{
+		furthestThreat = heading;
+	}
+	
+}
+
+//unit vector of each direction in direction_defs.h for the motor mixer, x is forwards and y is to the left
+static const int8_t directionX[4] = {0, 1, -1, 0};
+static const int8_t directionY[4] = {1, 0, 0, -1};
+
+//heads along the furthest threat, adding a move to the side when the sensors push the robot that way as well
+void head_towards_free_space()
+{
+	//weighted free direction, each sensor pushes the robot away from its threat in proportion to how close it is
+	int32_t push_x = (int32_t)threat_distance[BACK] - threat_distance[FRONT];
+	int32_t push_y = (int32_t)threat_distance[RIGHT] - threat_distance[LEFT];
+	
+	int8_t x = directionX[furthestThreat];
+	int8_t y = directionY[furthestThreat];
+	int32_t along = x ? push_x : push_y;
+	int32_t across = x ? push_y : push_x;
+	
+	if (along < 0) along = -along;
+	
+	//only 8 directions, the side push has to be past 22.5 degrees (tan is about 5/12) to go diagonally
+	if (across * 12 > along * 5 || across * 12 < -along * 5)
+	{
+		if (x) y = (across > 0) ? 1 : -1;
+		else x = (across > 0) ? 1 : -1;
+	}
+	
+	motor_mix(x, y, 0, motor_top_speed());
+}
+
 void move_away_from_threat()
 {
 	//check each direction to see which distance is furthest and move towards it
@@ -87,20 +168,31 @@ void move_away_from_threat()
 	{
 		if (i == furthestThreat)
 		{
-			//make sure bot is moving away from something close, otherwise just let it sit and wait
-			if(threat_distance[closestThreat] > MIN_INFRARED_THREAT)
+			//make sure bot is moving away from something close or closing in fast, otherwise just let it sit and wait
+			if(threat_distance[closestThreat] > MIN_INFRARED_THREAT || time_to_contact(closestThreat) <= ESCAPE_TTC_SWEEPS)
 			{
+				//heading straight at the closest threat, brake instead of waiting for the ramp down
+				if (motorControl.direction == closestThreat)
+				{
+					motor_brake();
+				}
+
+				//motor calls return right away, the E1 ramp ISR slews the motors while sensing continues
+			#if ESCAPE_DIAGONALS
+				head_towards_free_space();
+			#else
 				if (motorControl.direction != furthestThreat)
 				{
-					set_direction(furthestThreat);
+					motor_set_direction(furthestThreat);
 				}
-				set_speed_with_ramp(MOTOR_FAST_TICKS);
+				motor_set_target(motor_top_speed());
+			#endif
 				
 			}
 			else
 			{
 				//there is no threat within minimum threshold so just let the robot sit and wait
-				set_speed_with_ramp(0);
+				motor_set_target(0);
 			}
 			
 		}
@@ -124,14 +216,299 @@ uint8_t check_for_trapped()
 }
 
 
+//////////	State machine actions, each is called from the transition table and returns a follow up event or EVENT_NONE
+
+//called for every sweep of measurements while escaping
+uint8_t escape_from_threats(uint16_t payload)
+{
+	//add the new sweep to the filters (DMA mode) and copy the filtered distance measured by each infrared sensor
+	adc_read_sweep((uint8_t)payload);
+	set_infrSens_avg_to_threatDist();
+	
+	//check to see if the robot is trapped, i.e. all sides are above max threshold
+	if(check_for_trapped()) return EVENT_TRAPPED;
+	
+	determine_threat_order();
+	stabilize_heading();
+	
+	move_away_from_threat();
+	
+	//show the closest threat on lowest nibble and furthest threat on upper nibble
+	LED_PORT.OUT = (uint8_t)(closestThreat | (furthestThreat << 4));
+	
+	return EVENT_NONE;
+}
+
+//keeps the filters up to date when the measurements aren't being used
+uint8_t update_filters(uint16_t payload)
+{
+	adc_read_sweep((uint8_t)payload);
+	
+	return EVENT_NONE;
+}
+
+//tells the robot to spin, the spin is timed once it is up to speed
+uint8_t start_spin(uint16_t payload)
+{
+	set_spinTimer(0);
+	set_LEDTimer(0);
+	motor_set_direction(SPIN_CC);
+	motor_set_target(motor_top_speed());
+	
+	//already spinning at full speed, there won't be a ramp done event
+	if(motor_ramp_done()) return EVENT_AT_SPEED;
+	
+	return EVENT_NONE;
+}
+
+//ignore ramps that finished before the spin was started
+uint8_t check_spin_speed(uint16_t payload)
+{
+	if(motor_ramp_done()) return EVENT_AT_SPEED;
+	
+	return EVENT_NONE;
+}
+
+uint8_t start_spin_timers(uint16_t payload)
+{
+	//turn on LED timer for 100ms
+	set_LEDTimer(50000);
+	
+	//turn on spinning timer so we can end the spin
+	set_spinTimer(SPIN_PERIODS);
+	
+	return EVENT_NONE;
+}
+
+//do LED light show while spinning
+uint8_t spin_led(uint16_t payload)
+{
+	next_spin_led();
+	
+	return EVENT_NONE;
+}
+
+//stops the robot and starts escaping from scratch, used after a spin and when leaving testing
+uint8_t stop_and_reset(uint16_t payload)
+{
+	//turn off the spin timer and LED timer in case the robot was spinning
+	set_spinTimer(0);
+	set_LEDTimer(0);
+	
+	//stop moving, the motors ramp down while the sensors start measuring again
+	motor_set_target(0);
+	
+	//reset the sensors so old measurements aren't used to decide where to go
+	reset_infSens();
+	
+	return EVENT_NONE;
+}
+
+//testing actions, the buttons control the motors directly
+uint8_t test_speed_stop(uint16_t payload)
+{
+	motorControl.target_speed_ticks = 0;
+	motor_set_target(motorControl.target_speed_ticks);
+	
+	return EVENT_NONE;
+}
+
+uint8_t test_speed_fast(uint16_t payload)
+{
+	motorControl.target_speed_ticks = motor_top_speed();
+	motor_set_target(motorControl.target_speed_ticks);
+	
+	return EVENT_NONE;
+}
+
+uint8_t test_left(uint16_t payload)
+{
+	motor_set_direction(LEFT);
+	
+	return EVENT_NONE;
+}
+
+uint8_t test_forward(uint16_t payload)
+{
+	motor_set_direction(FORWARD);
+	
+	return EVENT_NONE;
+}
+
+uint8_t test_backward(uint16_t payload)
+{
+	motor_set_direction(BACKWARD);
+	
+	return EVENT_NONE;
+}
+
+uint8_t test_right(uint16_t payload)
+{
+	motor_set_direction(RIGHT);
+	
+	return EVENT_NONE;
+}
+
+#if ISR_PROFILING
+//copies the ISR timings and CPU load into profileReport for the debugger and starts measuring again
+uint8_t test_dump_profile(uint16_t payload)
+{
+	profile_dump();
+	
+	return EVENT_NONE;
+}
+#endif
+
+
+//////////	Transition table, stored in flash. Each entry is the action to run and the state to go to afterwards
+//////////	Entries that aren't listed do nothing and stay in the same state
+
+typedef uint8_t (*smAction_t)(uint16_t payload);
+
+struct smEntry_t
+{
+	smAction_t action;
+	uint8_t next_state;
+};
+
+//next_state is stored as state + 1 so that 0 (unlisted entries) means stay in the current state
+#define STAY 0
+#define TO(s) ((s) + 1)
+
+static const struct smEntry_t transitionTable[NUM_STATES][NUM_EVENT_TYPES] PROGMEM =
+{
+	[ESCAPING] =
+	{
+		[EVENT_SWEEP_DONE]	= {escape_from_threats,	STAY},
+		[EVENT_TRAPPED]		= {start_spin,			TO(TRAPPED)},
+		[EVENT_BUTTON_5]	= {start_spin,			TO(TRAPPED)},
+		[EVENT_BUTTON_6]	= {start_spin,			TO(TRAPPED)},
+		[EVENT_BUTTON_8]	= {0,					TO(TESTING)},
+	},
+	
+	//trapped is the spin ramping up, the spin is only timed once it is at full speed
+	[TRAPPED] =
+	{
+		[EVENT_SWEEP_DONE]	= {update_filters,		STAY},
+		[EVENT_RAMP_DONE]	= {check_spin_speed,	STAY},
+		[EVENT_AT_SPEED]	= {start_spin_timers,	TO(SPINNING)},
+		[EVENT_BUTTON_7]	= {stop_and_reset,		TO(ESCAPING)},
+		[EVENT_BUTTON_8]	= {stop_and_reset,		TO(TESTING)},
+	},
+	
+	[SPINNING] =
+	{
+		[EVENT_SWEEP_DONE]	= {update_filters,		STAY},
+		[EVENT_LED_TOGGLE]	= {spin_led,			STAY},
+		[EVENT_SPIN_DONE]	= {stop_and_reset,		TO(ESCAPING)},
+		[EVENT_BUTTON_7]	= {stop_and_reset,		TO(ESCAPING)},
+		[EVENT_BUTTON_8]	= {stop_and_reset,		TO(TESTING)},
+	},
+	
+	[TESTING] =
+	{
+		[EVENT_SWEEP_DONE]	= {update_filters,		STAY},
+		[EVENT_BUTTON_1]	= {test_speed_stop,		STAY},
+		[EVENT_BUTTON_2]	= {test_speed_fast,		STAY},
+		[EVENT_BUTTON_3]	= {test_left,			STAY},
+		[EVENT_BUTTON_4]	= {test_forward,		STAY},
+		[EVENT_BUTTON_5]	= {test_backward,		STAY},
+		[EVENT_BUTTON_6]	= {test_right,			STAY},
+		[EVENT_BUTTON_7]	= {stop_and_reset,		TO(ESCAPING)},
+#if ISR_PROFILING
+		//already testing so button 8 has nothing else to do here, see ISR_PROFILING
+		[EVENT_BUTTON_8]	= {test_dump_profile,	STAY},
+#endif
+	},
+};
+
+#if SM_MEASURE_LATENCY
+//read these with the debugger, latency is indexed by event type
+volatile struct smLatency_t smLatency[NUM_EVENT_TYPES];
+volatile struct smTransition_t smTrace[SM_TRACE_SIZE];
+volatile uint8_t smTraceIndex = 0;
+#endif
+
+//runs the action for the event in the current state, then any follow up events the action returns
+//timestamp is when the event was posted, follow up events keep the timestamp of the event that caused them.
+//Returns 1 if an action ran or the state changed, 0 if the event was ignored in this state
+uint8_t dispatch_event(uint8_t type, uint16_t payload, uint16_t timestamp)
+{
+	uint8_t changed = 0;
+	
+	while(type != EVENT_NONE && type < NUM_EVENT_TYPES)
+	{
+		const struct smEntry_t *entry = &transitionTable[state][type];
+		smAction_t action = (smAction_t)pgm_read_word(&entry->action);
+		uint8_t next_state = pgm_read_byte(&entry->next_state);
+		
+#if SM_MEASURE_LATENCY
+		uint16_t latency = event_timestamp() - timestamp;
+		
+		smLatency[type].last = latency;
+		if(latency > smLatency[type].max) smLatency[type].max = latency;
+		smLatency[type].count++;
+#endif
+		
+		uint8_t follow_up = action ? action(payload) : EVENT_NONE;
+		
+		if(action || next_state != STAY) changed = 1;
+		
+		if(next_state != STAY)
+		{
+#if SM_MEASURE_LATENCY
+			smTrace[smTraceIndex].from_state = state;
+			smTrace[smTraceIndex].event = type;
+			smTrace[smTraceIndex].to_state = next_state - 1;
+			smTrace[smTraceIndex].timestamp = timestamp;
+			smTraceIndex = (smTraceIndex + 1) % SM_TRACE_SIZE;
+#endif
+			state = next_state - 1;
+		}
+		
+		type = follow_up;
+		payload = 0;
+	}
+	
+	return changed;
+}
+
+//carries on after a warm restart, the state, filters and motor targets have been restored by restart_restore()
+void resume_after_restart()
+{
+	//the spin timers were lost in the reset so start the spin again
+	if(state == TRAPPED || state == SPINNING)
+	{
+		state = ESCAPING;
+		dispatch_event(EVENT_TRAPPED, 0, event_timestamp());
+	}
+	
+}
+
+
 int main(void)
 {
+	struct event_t event;
+	uint8_t changed;
+	
+	//check for a brown out before anything is set up, this also starts C0 so the restart can be timed
+	uint8_t restart = restart_begin();
 	
 	set_Clock_32MHz();
-	initialize_semaphores();
-	initialize_motorControl();
-	initialize_threat_distances();
-	reset_infSens();
+	setup_C0_eventTimer();		//C0 is a free running timer used to timestamp events, switched to its 32MHz prescaler
+	initialize_events();
+	
+	if(restart == RESTART_WARM)
+	{
+		//carry on with the filters and motors as they were
+		restart_restore();
+	}
+	else
+	{
+		initialize_motorControl();
+		initialize_threat_distances();
+		reset_infSens();
+	}
 	
 	//clear interrupts
 	cli();
@@ -139,11 +516,17 @@ int main(void)
 	setup_timer_D1();			//D1 is used to control the timing for infrared sensor measurements
 	setup_gpio();				//declares polarity for gpio ports
 	setup_ADCB();				//sets up pins 0-3 for use with infrared sensors
+	setup_ADCA_battery();		//measures the pack voltage when BATTERY_ADAPT is set
+	setup_DMA_ADCB();			//moves ADCB results into sample blocks when ADC_USE_DMA is set
+	setup_USARTC0_telemetry();	//USARTC0 sends telemetry frames through DMA channel 2 when TELEMETRY is set
 	setup_E0_motorControl();	//E0 is used as PWM for controlling the motors
 	setup_E1_motorRamp();		//E1 is the timer that is used for ramping up/down the pulse width in E0
 	setup_btn_interrupt();		//sets up interrupts for buttons
-	setup_C1_spinTimer();		//initialize timer used for controlling spin state
-	setup_F1_LEDTimer();		//initialize timer used for toggling the LEDs
+	setup_C0_LEDTimer();		//C0 compare A is used for toggling the LEDs
+	setup_QDEC_encoders();		//C1, F0 and F1 decode the wheel encoders when MOTOR_CLOSED_LOOP is set
+	setup_power_measurement();	//measures time spent asleep when POWER_MEASUREMENT is set
+	setup_F1_profileTimer();	//F1 times the ISRs when ISR_PROFILING is set
+	setup_sleep();				//main sleeps in idle between interrupts
 
 	
 	//enable low, med, and high level interrupts
@@ -152,114 +535,34 @@ int main(void)
 	//turn interrupts back on
 	sei();
 	
-	//set motors to 0 ticks to start
-	set_speed_with_ramp(0);
-	
-	//set state to escaping to start
-	state = ESCAPING;
+	if(restart == RESTART_WARM)
+	{
+		resume_after_restart();
+	}
+	else
+	{
+		//set state to escaping to start with the motors at 0 ticks
+		state = ESCAPING;
+		stop_and_reset(0);
+	}
 
 	while(1)
 	{
-		//escaping state
-		while(state == ESCAPING)
-		{
-			//check to see if all measurements are done
-			if(semaphores.left_meas_done && semaphores.back_meas_done && semaphores.front_meas_done && semaphores.right_meas_done)
-			{
-				//toggle lowest bit on LED's so that we can see the measurement status
-				//LED_PORT.OUT ^= 0x01;
-				
-				//calculate the average distance measured by each infrared sensor
-				set_infrSens_avg_to_threatDist();
-				
-				//check to see if the robot is trapped, i.e. all sides are above max threshold
-				if(check_for_trapped())
-				{
-					state = TRAPPED;	//set state to trapped
-					break;	//break out of while loop so that trapped state can be entered
-				}
-				
-				determine_threat_order();
-				
-				move_away_from_threat();
-				
-				reset_infSens();
-				
-				clear_meas_sems();
-				
-				//show the closest threat on lowest nibble and furthest threat on upper nibble
-				LED_PORT.OUT = (uint8_t)(closestThreat | (furthestThreat << 4));
-				
-			}	
-			
-		}	//end of escaping state while loop
+		//sleep until an ISR posts an event
+		SLEEP_UNLESS(event_pending());
 		
-		while(state == TESTING)
+		//handle every waiting event in the order they happened before going back to sleep
+		changed = 0;
+		while(event_pop(&event))
 		{
-			//check to see if change direction semaphore has been thrown by button press
-			if(semaphores.change_direction)
-			{
-				set_direction(motorControl.direction);
-				semaphores.change_direction = 0;
-			}
-			
-			//check to see if change speed semaphore has been thrown by button press
-			if(semaphores.change_speed)
-			{
-				set_speed_with_ramp(motorControl.target_speed_ticks);
-				semaphores.change_speed = 0;
-			}	
-			
-		}	//end of testing state
-		
-		while(state == TRAPPED)
-		{		
-			//set state to spinning
-			state = SPINNING;
-			
-			
+			changed |= dispatch_event(event.type, event.payload, event.timestamp);
 		}
 		
-		while(state == SPINNING)
-		{
-			//tell the robot to spin
-			set_direction(SPIN_CC);
-			set_speed_with_ramp(MOTOR_FAST_TICKS);
-			
-			//turn on LED timer for 100ms
-			set_LEDTimer(50000);
-			
-			//turn on spinning timer so we can end the spin
-			semaphores.spin_complete = 0;	//set to 0 so ISR can set it to 1
-			set_spinTimer(SPIN_TICKS);
-			
-			//wait for the spin to finish, do LED light show while we wait
-			while(!semaphores.spin_complete)
-			{
-				if(semaphores.led_toggle) 
-				{
-					next_spin_led();
-					semaphores.led_toggle = 0;
-				}
-			}
-			
-			semaphores.spin_complete = 0;
-			
-			//turn off the spin timer
-			set_spinTimer(0);
-			//turn off LED_timer
-			set_LEDTimer(0);
-			//stop spinning
-			set_speed_with_ramp(0);
-				
-			//after spin is done, return to escaping state
-			//reset the sensors so they can start performing measurements
-			reset_infSens();	
-			clear_meas_sems();
-			state = ESCAPING;
-			
-		}	//end of spinning state
+		//save the state in case of a brown out, skipped when every event was ignored
+		restart_checkpoint(changed);
 		
+		//snapshot out of the telemetry port, dropped if the last one hasn't finished sending
+		telemetry_send();
 		
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,160 @@
+/*
+ * events.c
+ *
+ * Created: 10/17/2026 10:04:12 AM
+ *  Author: Clint
+ *
+ *	ISRs post events to a ring queue and main drains them in batches. Every interrupt level has its own
+ *	queue so each one has a single producer and a single consumer, and neither side ever has to lock the
+ *	queue. Events carry a sequence number so main can take them out of the queues in the order they were
+ *	posted, and a timestamp from the free running C0 timer.
+ */ 
+
+#include "events.h"
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+
+#if EVENT_QUEUE_SIZE & EVENT_QUEUE_MASK
+#error "EVENT_QUEUE_SIZE must be a power of 2"
+#endif
+
+static volatile struct eventQueue_t eventQueues[NUM_EVENT_QUEUES];
+
+//sequence number of the next event posted on any level
+static uint8_t eventSeq = 0;
+
+//C0 is a free running timer used to timestamp events
+void setup_C0_eventTimer()
+{
+	//count the full 16 bits (assuming 32MHz clock, this is 131ms with 64 prescale)
+	TCC0_PER = 0xFFFF;
+	
+	//set prescaler for counter to 64 counts per 1 tick
+	TCC0_CTRLA = 0x05;
+	
+}
+
+//returns the current C0 count, the read is done with interrupts off so a nested ISR reading the timer
+//can't corrupt the shared 16 bit TEMP register between the low and high byte
+uint16_t event_timestamp()
+{
+	uint16_t count;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		count = TCC0_CNT;
+	}
+	
+	return count;
+}
+
+void initialize_events()
+{
+	for (uint8_t q = 0; q < NUM_EVENT_QUEUES; q++)
+	{
+		eventQueues[q].head = 0;
+		eventQueues[q].tail = 0;
+		eventQueues[q].overflows = 0;
+		eventQueues[q].max_depth = 0;
+	}
+	
+	eventSeq = 0;
+}
+
+//called by ISRs, queue must be the queue for the interrupt level of the caller
+void event_post(uint8_t queue, uint8_t type, uint16_t payload)
+{
+	volatile struct eventQueue_t *q = &eventQueues[queue];
+	uint8_t head = q->head;
+	uint8_t depth = (head - q->tail) & EVENT_QUEUE_MASK;
+	
+	//one slot is always left empty so a full queue can be told apart from an empty one
+	if (depth == EVENT_QUEUE_MASK)
+	{
+		q->overflows++;
+		return;
+	}
+	
+	q->events[head].type = type;
+	q->events[head].payload = payload;
+	
+	//a medium level ISR can post in the middle of a low level one, take the number and the time together
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		q->events[head].seq = eventSeq++;
+		q->events[head].timestamp = TCC0_CNT;
+	}
+	
+	//publish the event only once it is completely written
+	q->head = (head + 1) & EVENT_QUEUE_MASK;
+	
+	if (depth + 1 > q->max_depth) q->max_depth = depth + 1;
+}
+
+//returns 1 if any queue has an event waiting
+uint8_t event_pending()
+{
+	for (uint8_t q = 0; q < NUM_EVENT_QUEUES; q++)
+	{
+		if (eventQueues[q].head != eventQueues[q].tail) return 1;
+	}
+	
+	return 0;
+}
+
+//copies the first posted waiting event out of the queues, returns 0 if there are none
+uint8_t event_pop(struct event_t *event)
+{
+	uint8_t oldest_seq = 0;
+	int8_t oldest = -1;
+	
+	//find the queue whose next event was posted first, the difference is taken signed so the 8 bit wrap doesn't matter
+	for (uint8_t q = 0; q < NUM_EVENT_QUEUES; q++)
+	{
+		uint8_t tail = eventQueues[q].tail;
+		
+		if (eventQueues[q].head == tail) continue;
+		
+		uint8_t seq = eventQueues[q].events[tail].seq;
+		
+		if (oldest < 0 || (int8_t)(seq - oldest_seq) < 0)
+		{
+			oldest = q;
+			oldest_seq = seq;
+		}
+	}
+	
+	if (oldest < 0) return 0;
+	
+	volatile struct eventQueue_t *q = &eventQueues[oldest];
+	uint8_t tail = q->tail;
+	
+	event->type = q->events[tail].type;
+	event->payload = q->events[tail].payload;
+	event->timestamp = q->events[tail].timestamp;
+	event->seq = q->events[tail].seq;
+	
+	//free the slot only once the event has been copied out
+	q->tail = (tail + 1) & EVENT_QUEUE_MASK;
+	
+	return 1;
+}
+
+//returns the total number of events dropped by all queues, 0 means no event has ever been lost
+uint16_t event_overflows()
+{
+	uint16_t overflows = 0;
+	
+	for (uint8_t q = 0; q < NUM_EVENT_QUEUES; q++)
+	{
+		//the counter is written by an ISR so read both bytes together
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			overflows += eventQueues[q].overflows;
+		}
+	}
+	
+	return overflows;
+}
@@ -0,0 +1,83 @@
+/*
+ * events.h
+ *
+ * Created: 10/17/2026 10:03:47 AM
+ *  Author: Clint
+ */ 
+
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <avr/io.h>
+
+//number of events each queue can hold, must be a power of 2
+#define EVENT_QUEUE_SIZE 16
+
+//there is one queue per interrupt level. ISRs on the same level can't interrupt each other, so each queue
+//has a single producer (its interrupt level) and a single consumer (main) and needs no locking
+#define EVENT_QUEUE_LO 0
+#define EVENT_QUEUE_MED 1
+#define NUM_EVENT_QUEUES 2
+
+//event types, these are also the columns of the state machine transition table in escape_robot.c
+#define EVENT_NONE 0
+#define EVENT_SWEEP_DONE 1		//new infrared measurements are ready, payload is the DMA block (DMA mode only)
+#define EVENT_RAMP_DONE 2		//all motors reached their target speed
+#define EVENT_SPIN_DONE 3		//spin timer overflowed
+#define EVENT_LED_TOGGLE 4		//LED timer overflowed
+#define EVENT_BUTTON_1 5		//buttons 1 to 8 pressed, posted by the PORTJ ISR
+#define EVENT_BUTTON_2 6
+#define EVENT_BUTTON_3 7
+#define EVENT_BUTTON_4 8
+#define EVENT_BUTTON_5 9
+#define EVENT_BUTTON_6 10
+#define EVENT_BUTTON_7 11
+#define EVENT_BUTTON_8 12
+
+//internal events, returned by state machine actions instead of being posted by an ISR
+#define EVENT_TRAPPED 13		//all sensors are above TRAPPED_INFRARED
+#define EVENT_AT_SPEED 14		//the spin is up to full speed
+
+#define NUM_EVENT_TYPES 15
+
+struct event_t
+{
+	uint8_t type;
+	uint16_t payload;
+	
+	//TCC0 count when the event was posted (2us per tick)
+	uint16_t timestamp;
+	
+	//posting order across all queues, the timestamp can't be used for that since C0 wraps every 131ms.
+	//8 bits is plenty as there are never more than 2 * EVENT_QUEUE_SIZE events waiting
+	uint8_t seq;
+	
+};
+
+struct eventQueue_t
+{
+	struct event_t events[EVENT_QUEUE_SIZE];
+	
+	//head is only written by the producer and tail only by main
+	uint8_t head;
+	uint8_t tail;
+	
+	//written by the producer, number of events dropped because the queue was full
+	uint16_t overflows;
+	
+	//written by the producer, most events that were waiting in the queue at once
+	uint8_t max_depth;
+	
+};
+
+void setup_C0_eventTimer();
+uint16_t event_timestamp();
+void initialize_events();
+void event_post(uint8_t queue, uint8_t type, uint16_t payload);
+uint8_t event_pending();
+uint8_t event_pop(struct event_t *event);
+uint16_t event_overflows();
+
+
+#endif /* EVENTS_H_ */
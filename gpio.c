@@ -7,15 +7,14 @@
 
 #include "gpio.h"
 #include "led_definitions.h"
-#include "motor_control.h"
-#include "semaphores.h"
-#include "state_defs.h"
+#include "events.h"
+#include "profile.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
-extern struct semaphore_t semaphores;
-extern struct motorControl_t motorControl;
-extern uint8_t state;
+//LED timer period in C0 ticks, 0 when it is stopped
+static uint16_t ledTimerTicks = 0;
 
 void setup_gpio()
 {
@@ -58,106 +57,53 @@ void setup_btn_interrupt()
 	
 }
 
-//interrupt for handling button presses
+//interrupt for handling button presses, the state machine in main decides what each button does
 ISR(PORTJ_INT0_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_PORTJ_INT0);
 	LED_PORT.OUT ^= 0x80;	//toggle msb for debugging
 	
-	//use portj's input (i.e. which button is pressed) to figure out what to do
+	//use portj's input (i.e. which button is pressed) to figure out which event to post
 	switch(PORTJ_IN)
 	{
-		case (BUTTON_1):
-			//set speed to 0
-			motorControl.target_speed_ticks = 0;
-			semaphores.change_speed = 1;
-		
-			break;
-		
-		case (BUTTON_2):
-			//change speed to fast
-			motorControl.target_speed_ticks = MOTOR_FAST_TICKS;
-			semaphores.change_speed = 1;
-		
-			break;
-		
-		case (BUTTON_3):
-			//change motor to left
-			motorControl.direction = LEFT;
-			semaphores.change_direction = 1;
-		
-			break;
-		
-		case (BUTTON_4):
-			//change motor to forward
-			motorControl.direction = FORWARD;
-			semaphores.change_direction = 1;
-		
-			break;
-		
-		case(BUTTON_5):
-			if (state == TESTING)
-			{
-				//change motor to backwards
-				motorControl.direction = BACKWARD;
-				semaphores.change_direction = 1;
-			}
-			else
-			{
-				state = SPINNING;
-			}
-		
-			break;
-		
-		case(BUTTON_6):
-			if (state == TESTING)
-			{
-				//change motor to right
-				motorControl.direction = RIGHT;
-				semaphores.change_direction = 1;
-			}
-			else
-			{
-				state = TRAPPED;
-			}
-		
-			break;
-		
-		case(BUTTON_7):
-			state = ESCAPING;
-		
-			break;
-		
-		case(BUTTON_8):
-			//set state to testing
-			state = TESTING;
-		
-			break;
+		case (BUTTON_1): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_1, 0); break;
+		case (BUTTON_2): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_2, 0); break;
+		case (BUTTON_3): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_3, 0); break;
+		case (BUTTON_4): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_4, 0); break;
+		case (BUTTON_5): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_5, 0); break;
+		case (BUTTON_6): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_6, 0); break;
+		case (BUTTON_7): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_7, 0); break;
+		case (BUTTON_8): event_post(EVENT_QUEUE_MED, EVENT_BUTTON_8, 0); break;
 		
 		default:
 		//no valid button pressed do nothing
 		break;
-		
 	}
 	
+	PROFILE_ISR_EXIT(PROFILE_PORTJ_INT0);
 }
 
-void setup_F1_LEDTimer()
+//the LED timer uses the CCA compare of the free running C0 event timer (2us per tick, set up by setup_C0_eventTimer)
+//so F1 is free to decode a wheel encoder (see encoder.c)
+void setup_C0_LEDTimer()
 {
-	//setup period for timer to 50000 ticks (assuming 32MHz clock and 64 prescale, this is 100ms)
-	TCF1_PER = 0
-	;
-
-	//set prescaler for counter to 64 counts per 1 tick
-	TCF1_CTRLA = 0x05;
-
-	//set interrupt priority to low
-	TCF1_INTCTRLA = 0x01;
+	//interrupt is turned on at low priority by set_LEDTimer()
+	TCC0_INTCTRLB &= ~TC0_CCAINTLVL_gm;
 	
 }
 
-ISR(TCF1_OVF_vect)
+ISR(TCC0_CCA_vect)
 {
-	semaphores.led_toggle = 1;
+	PROFILE_ISR_ENTER(PROFILE_TCC0_CCA);
+	//move the compare on by one period so the toggles stay evenly spaced, C0 is also read by
+	//event_timestamp() in medium level ISRs so don't let them use its TEMP register in between
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TCC0_CCA += ledTimerTicks;
+	}
+	
+	event_post(EVENT_QUEUE_LO, EVENT_LED_TOGGLE, 0);
+	PROFILE_ISR_EXIT(PROFILE_TCC0_CCA);
 }
 
 void next_spin_led()
@@ -166,8 +112,16 @@ void next_spin_led()
 	else LED_PORT.OUT *= 2;	
 }
 
+//starts the LED timer with the period passed (50000 ticks is 100ms), 0 stops it
 void set_LEDTimer(uint16_t ticks)
 {
-	TCF1_PER = ticks;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ledTimerTicks = ticks;
+		TCC0_CCA = TCC0_CNT + ticks;
+		
+		//clear any old compare match, then no interrupts while stopped so the event queue isn't flooded
+		TCC0_INTFLAGS = TC0_CCAIF_bm;
+		TCC0_INTCTRLB = (TCC0_INTCTRLB & ~TC0_CCAINTLVL_gm) | (ticks ? TC_CCAINTLVL_LO_gc : TC_CCAINTLVL_OFF_gc);
+	}
 }
-
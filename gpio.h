@@ -22,7 +22,7 @@
 
 void setup_gpio();
 void setup_btn_interrupt();
-void setup_F1_LEDTimer();
+void setup_C0_LEDTimer();
 void next_spin_led();
 void set_LEDTimer(uint16_t ticks);
 
@@ -0,0 +1,45 @@
+/*
+ * hal.h
+ *
+ * Created: 10/17/2026 6:20:37 PM
+ *  Author: Clint
+ *
+ *	Hardware abstraction for the few places where the firmware can't just read and write XMEGA registers.
+ *	Everything else uses the registers directly, in the host build (see host/) they are fields of a
+ *	simulated peripheral model instead of I/O memory.
+ */
+
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <avr/io.h>
+
+#ifdef HOST_BUILD
+
+//the host has 64 bit pointers, so the simulated DMA channels keep the whole address instead of 3 address bytes
+#define HAL_DMA_SRCADDR(ch, address) ((ch)->host_srcaddr = (volatile void *)(address))
+#define HAL_DMA_DESTADDR(ch, address) ((ch)->host_destaddr = (volatile void *)(address))
+
+//polling a register only ends once the simulated peripherals have moved on
+void sim_busy_wait();
+#define HAL_BUSY_WAIT() sim_busy_wait()
+
+#else
+
+//DMA addresses are 24 bits, SRAM is always in the lowest 64k
+#define HAL_DMA_SRCADDR(ch, address) do { (ch)->SRCADDR0 = (uint8_t)((uint16_t)(address)); \
+	(ch)->SRCADDR1 = (uint8_t)((uint16_t)(address) >> 8); (ch)->SRCADDR2 = 0; } while (0)
+#define HAL_DMA_DESTADDR(ch, address) do { (ch)->DESTADDR0 = (uint8_t)((uint16_t)(address)); \
+	(ch)->DESTADDR1 = (uint8_t)((uint16_t)(address) >> 8); (ch)->DESTADDR2 = 0; } while (0)
+
+#define HAL_BUSY_WAIT()
+
+#endif
+
+//system clock functions from libAVRX_Clocks.a, which doesn't come with a header (the host build has its own)
+void SetSystemClock(uint8_t clk_src, uint8_t prescaler_a, uint8_t prescaler_bc);
+void GetSystemClocks(volatile unsigned long *sys_clk, volatile unsigned long *per_clk);
+
+
+#endif /* HAL_H_ */
@@ -0,0 +1,54 @@
+/*
+ * interrupt.h
+ *
+ * Created: 10/17/2026 6:31:47 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <avr/interrupt.h>. An ISR is a plain function named after its vector that
+ *	sim.c calls when the simulated peripheral raises the interrupt. The vectors are weak so sim.c can tell
+ *	which ones the firmware has actually defined.
+ */
+
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <stdint.h>
+
+//global interrupt enable, the I bit of SREG
+extern volatile uint8_t sim_sreg_i;
+
+#define sei() (sim_sreg_i = 1)
+#define cli() (sim_sreg_i = 0)
+
+#define ISR(vector) void vector(void)
+
+#define SIM_VECTOR(vector) void vector(void) __attribute__((weak))
+
+SIM_VECTOR(TCC0_OVF_vect);
+SIM_VECTOR(TCC0_CCA_vect);
+SIM_VECTOR(TCC0_CCB_vect);
+SIM_VECTOR(TCC0_CCC_vect);
+SIM_VECTOR(TCC0_CCD_vect);
+SIM_VECTOR(TCC1_OVF_vect);
+SIM_VECTOR(TCD0_OVF_vect);
+SIM_VECTOR(TCD0_CCA_vect);
+SIM_VECTOR(TCD0_CCB_vect);
+SIM_VECTOR(TCD0_CCC_vect);
+SIM_VECTOR(TCD0_CCD_vect);
+SIM_VECTOR(TCD1_OVF_vect);
+SIM_VECTOR(TCE0_OVF_vect);
+SIM_VECTOR(TCE1_OVF_vect);
+SIM_VECTOR(TCF0_OVF_vect);
+SIM_VECTOR(TCF1_OVF_vect);
+SIM_VECTOR(PORTJ_INT0_vect);
+SIM_VECTOR(ADCA_CH0_vect);
+SIM_VECTOR(ADCB_CH0_vect);
+SIM_VECTOR(ADCB_CH1_vect);
+SIM_VECTOR(ADCB_CH2_vect);
+SIM_VECTOR(ADCB_CH3_vect);
+SIM_VECTOR(DMA_CH0_vect);
+SIM_VECTOR(DMA_CH1_vect);
+
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,823 @@
+/*
+ * io.h
+ *
+ * Created: 10/17/2026 6:24:03 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <avr/io.h>. Every peripheral the firmware uses is a struct in plain memory with
+ *	the same register names as the ATxmega128A1 header, so the firmware sources build unchanged. sim.c reads and
+ *	writes these structs to act as the hardware. Only the registers and bit values the firmware uses are here,
+ *	the bit values are the real XMEGA ones since the simulator decodes them.
+ */
+
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+typedef struct PORT_struct
+{
+	register8_t DIR;
+	register8_t DIRSET;
+	register8_t DIRCLR;
+	register8_t DIRTGL;
+	register8_t OUT;
+	register8_t OUTSET;
+	register8_t OUTCLR;
+	register8_t OUTTGL;
+	register8_t IN;
+	register8_t INTCTRL;
+	register8_t INT0MASK;
+	register8_t INT1MASK;
+	register8_t INTFLAGS;
+	register8_t PIN0CTRL;
+	register8_t PIN1CTRL;
+	register8_t PIN2CTRL;
+	register8_t PIN3CTRL;
+	register8_t PIN4CTRL;
+	register8_t PIN5CTRL;
+	register8_t PIN6CTRL;
+	register8_t PIN7CTRL;
+} PORT_t;
+
+//TC1_t is the same with CCC and CCD unused, one type keeps the simulator simple
+typedef struct TC0_struct
+{
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t CTRLC;
+	register8_t CTRLD;
+	register8_t CTRLE;
+	register8_t INTCTRLA;
+	register8_t INTCTRLB;
+	register8_t CTRLFCLR;
+	register8_t CTRLFSET;
+	register8_t CTRLGCLR;
+	register8_t CTRLGSET;
+	register8_t INTFLAGS;
+	register8_t TEMP;
+	register16_t CNT;
+	register16_t PER;
+	register16_t CCA;
+	register16_t CCB;
+	register16_t CCC;
+	register16_t CCD;
+	register16_t PERBUF;
+	register16_t CCABUF;
+	register16_t CCBBUF;
+	register16_t CCCBUF;
+	register16_t CCDBUF;
+} TC0_t;
+
+typedef TC0_t TC1_t;
+
+typedef struct AWEX_struct
+{
+	register8_t CTRL;
+	register8_t FDEMASK;
+	register8_t FDCTRL;
+	register8_t STATUS;
+	register8_t DTBOTH;
+	register8_t DTBOTHBUF;
+	register8_t DTLS;
+	register8_t DTHS;
+	register8_t DTLSBUF;
+	register8_t DTHSBUF;
+	register8_t OUTOVEN;
+} AWEX_t;
+
+typedef struct ADC_CH_struct
+{
+	register8_t CTRL;
+	register8_t MUXCTRL;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register16_t RES;
+} ADC_CH_t;
+
+//CH0RES to CH3RES are next to each other like on the XMEGA, the DMA copies all 4 results in one burst
+typedef struct ADC_struct
+{
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t REFCTRL;
+	register8_t EVCTRL;
+	register8_t PRESCALER;
+	register8_t INTFLAGS;
+	register16_t CH0RES;
+	register16_t CH1RES;
+	register16_t CH2RES;
+	register16_t CH3RES;
+	register16_t CMP;
+	ADC_CH_t CH0;
+	ADC_CH_t CH1;
+	ADC_CH_t CH2;
+	ADC_CH_t CH3;
+} ADC_t;
+
+//the simulated DMA keeps the full host address of the source and destination, see HAL_DMA_SRCADDR in hal.h
+typedef struct DMA_CH_struct
+{
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t ADDRCTRL;
+	register8_t TRIGSRC;
+	register16_t TRFCNT;
+	register8_t REPCNT;
+	register8_t SRCADDR0;
+	register8_t SRCADDR1;
+	register8_t SRCADDR2;
+	register8_t DESTADDR0;
+	register8_t DESTADDR1;
+	register8_t DESTADDR2;
+	volatile void *host_srcaddr;
+	volatile void *host_destaddr;
+} DMA_CH_t;
+
+typedef struct DMA_struct
+{
+	register8_t CTRL;
+	register8_t INTFLAGS;
+	register8_t STATUS;
+	DMA_CH_t CH0;
+	DMA_CH_t CH1;
+	DMA_CH_t CH2;
+	DMA_CH_t CH3;
+} DMA_t;
+
+typedef struct USART_struct
+{
+	register8_t DATA;
+	register8_t STATUS;
+	register8_t reserved_0x02;
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t CTRLC;
+	register8_t BAUDCTRLA;
+	register8_t BAUDCTRLB;
+} USART_t;
+
+typedef struct EVSYS_struct
+{
+	register8_t CH0MUX;
+	register8_t CH1MUX;
+	register8_t CH2MUX;
+	register8_t CH3MUX;
+	register8_t CH4MUX;
+	register8_t CH5MUX;
+	register8_t CH6MUX;
+	register8_t CH7MUX;
+	register8_t CH0CTRL;
+	register8_t CH1CTRL;
+	register8_t CH2CTRL;
+	register8_t CH3CTRL;
+	register8_t CH4CTRL;
+	register8_t CH5CTRL;
+	register8_t CH6CTRL;
+	register8_t CH7CTRL;
+	register8_t STROBE;
+	register8_t DATA;
+} EVSYS_t;
+
+typedef struct PMIC_struct
+{
+	register8_t STATUS;
+	register8_t INTPRI;
+	register8_t CTRL;
+} PMIC_t;
+
+typedef struct RST_struct
+{
+	register8_t STATUS;
+	register8_t CTRL;
+} RST_t;
+
+typedef struct PORTCFG_struct
+{
+	register8_t MPCMASK;
+	register8_t VPCTRLA;
+	register8_t VPCTRLB;
+	register8_t CLKEVOUT;
+} PORTCFG_t;
+
+//peripheral instances, defined in sim.c
+
+extern PORT_t PORTA;
+extern PORT_t PORTB;
+extern PORT_t PORTC;
+extern PORT_t PORTD;
+extern PORT_t PORTE;
+extern PORT_t PORTF;
+extern PORT_t PORTH;
+extern PORT_t PORTJ;
+extern TC0_t TCC0;
+extern TC0_t TCC1;
+extern TC0_t TCD0;
+extern TC0_t TCD1;
+extern TC0_t TCE0;
+extern TC0_t TCE1;
+extern TC0_t TCF0;
+extern TC0_t TCF1;
+extern AWEX_t AWEXE;
+extern ADC_t ADCA;
+extern ADC_t ADCB;
+extern DMA_t DMA;
+extern USART_t USARTC0;
+extern EVSYS_t EVSYS;
+extern PMIC_t PMIC;
+extern RST_t RST;
+extern PORTCFG_t PORTCFG;
+
+//flat register names, e.g. PORTD_OUT for PORTD.OUT
+#define PORTA_DIR PORTA.DIR
+#define PORTA_DIRSET PORTA.DIRSET
+#define PORTA_DIRCLR PORTA.DIRCLR
+#define PORTA_DIRTGL PORTA.DIRTGL
+#define PORTA_OUT PORTA.OUT
+#define PORTA_OUTSET PORTA.OUTSET
+#define PORTA_OUTCLR PORTA.OUTCLR
+#define PORTA_OUTTGL PORTA.OUTTGL
+#define PORTA_IN PORTA.IN
+#define PORTA_INTCTRL PORTA.INTCTRL
+#define PORTA_INT0MASK PORTA.INT0MASK
+#define PORTA_INT1MASK PORTA.INT1MASK
+#define PORTA_INTFLAGS PORTA.INTFLAGS
+#define PORTA_PIN0CTRL PORTA.PIN0CTRL
+#define PORTA_PIN1CTRL PORTA.PIN1CTRL
+#define PORTA_PIN2CTRL PORTA.PIN2CTRL
+#define PORTA_PIN3CTRL PORTA.PIN3CTRL
+#define PORTA_PIN4CTRL PORTA.PIN4CTRL
+#define PORTA_PIN5CTRL PORTA.PIN5CTRL
+#define PORTA_PIN6CTRL PORTA.PIN6CTRL
+#define PORTA_PIN7CTRL PORTA.PIN7CTRL
+
+#define PORTB_DIR PORTB.DIR
+#define PORTB_DIRSET PORTB.DIRSET
+#define PORTB_DIRCLR PORTB.DIRCLR
+#define PORTB_DIRTGL PORTB.DIRTGL
+#define PORTB_OUT PORTB.OUT
+#define PORTB_OUTSET PORTB.OUTSET
+#define PORTB_OUTCLR PORTB.OUTCLR
+#define PORTB_OUTTGL PORTB.OUTTGL
+#define PORTB_IN PORTB.IN
+#define PORTB_INTCTRL PORTB.INTCTRL
+#define PORTB_INT0MASK PORTB.INT0MASK
+#define PORTB_INT1MASK PORTB.INT1MASK
+#define PORTB_INTFLAGS PORTB.INTFLAGS
+#define PORTB_PIN0CTRL PORTB.PIN0CTRL
+#define PORTB_PIN1CTRL PORTB.PIN1CTRL
+#define PORTB_PIN2CTRL PORTB.PIN2CTRL
+#define PORTB_PIN3CTRL PORTB.PIN3CTRL
+#define PORTB_PIN4CTRL PORTB.PIN4CTRL
+#define PORTB_PIN5CTRL PORTB.PIN5CTRL
+#define PORTB_PIN6CTRL PORTB.PIN6CTRL
+#define PORTB_PIN7CTRL PORTB.PIN7CTRL
+
+#define PORTC_DIR PORTC.DIR
+#define PORTC_DIRSET PORTC.DIRSET
+#define PORTC_DIRCLR PORTC.DIRCLR
+#define PORTC_DIRTGL PORTC.DIRTGL
+#define PORTC_OUT PORTC.OUT
+#define PORTC_OUTSET PORTC.OUTSET
+#define PORTC_OUTCLR PORTC.OUTCLR
+#define PORTC_OUTTGL PORTC.OUTTGL
+#define PORTC_IN PORTC.IN
+#define PORTC_INTCTRL PORTC.INTCTRL
+#define PORTC_INT0MASK PORTC.INT0MASK
+#define PORTC_INT1MASK PORTC.INT1MASK
+#define PORTC_INTFLAGS PORTC.INTFLAGS
+#define PORTC_PIN0CTRL PORTC.PIN0CTRL
+#define PORTC_PIN1CTRL PORTC.PIN1CTRL
+#define PORTC_PIN2CTRL PORTC.PIN2CTRL
+#define PORTC_PIN3CTRL PORTC.PIN3CTRL
+#define PORTC_PIN4CTRL PORTC.PIN4CTRL
+#define PORTC_PIN5CTRL PORTC.PIN5CTRL
+#define PORTC_PIN6CTRL PORTC.PIN6CTRL
+#define PORTC_PIN7CTRL PORTC.PIN7CTRL
+
+#define PORTD_DIR PORTD.DIR
+#define PORTD_DIRSET PORTD.DIRSET
+#define PORTD_DIRCLR PORTD.DIRCLR
+#define PORTD_DIRTGL PORTD.DIRTGL
+#define PORTD_OUT PORTD.OUT
+#define PORTD_OUTSET PORTD.OUTSET
+#define PORTD_OUTCLR PORTD.OUTCLR
+#define PORTD_OUTTGL PORTD.OUTTGL
+#define PORTD_IN PORTD.IN
+#define PORTD_INTCTRL PORTD.INTCTRL
+#define PORTD_INT0MASK PORTD.INT0MASK
+#define PORTD_INT1MASK PORTD.INT1MASK
+#define PORTD_INTFLAGS PORTD.INTFLAGS
+#define PORTD_PIN0CTRL PORTD.PIN0CTRL
+#define PORTD_PIN1CTRL PORTD.PIN1CTRL
+#define PORTD_PIN2CTRL PORTD.PIN2CTRL
+#define PORTD_PIN3CTRL PORTD.PIN3CTRL
+#define PORTD_PIN4CTRL PORTD.PIN4CTRL
+#define PORTD_PIN5CTRL PORTD.PIN5CTRL
+#define PORTD_PIN6CTRL PORTD.PIN6CTRL
+#define PORTD_PIN7CTRL PORTD.PIN7CTRL
+
+#define PORTE_DIR PORTE.DIR
+#define PORTE_DIRSET PORTE.DIRSET
+#define PORTE_DIRCLR PORTE.DIRCLR
+#define PORTE_DIRTGL PORTE.DIRTGL
+#define PORTE_OUT PORTE.OUT
+#define PORTE_OUTSET PORTE.OUTSET
+#define PORTE_OUTCLR PORTE.OUTCLR
+#define PORTE_OUTTGL PORTE.OUTTGL
+#define PORTE_IN PORTE.IN
+#define PORTE_INTCTRL PORTE.INTCTRL
+#define PORTE_INT0MASK PORTE.INT0MASK
+#define PORTE_INT1MASK PORTE.INT1MASK
+#define PORTE_INTFLAGS PORTE.INTFLAGS
+#define PORTE_PIN0CTRL PORTE.PIN0CTRL
+#define PORTE_PIN1CTRL PORTE.PIN1CTRL
+#define PORTE_PIN2CTRL PORTE.PIN2CTRL
+#define PORTE_PIN3CTRL PORTE.PIN3CTRL
+#define PORTE_PIN4CTRL PORTE.PIN4CTRL
+#define PORTE_PIN5CTRL PORTE.PIN5CTRL
+#define PORTE_PIN6CTRL PORTE.PIN6CTRL
+#define PORTE_PIN7CTRL PORTE.PIN7CTRL
+
+#define PORTF_DIR PORTF.DIR
+#define PORTF_DIRSET PORTF.DIRSET
+#define PORTF_DIRCLR PORTF.DIRCLR
+#define PORTF_DIRTGL PORTF.DIRTGL
+#define PORTF_OUT PORTF.OUT
+#define PORTF_OUTSET PORTF.OUTSET
+#define PORTF_OUTCLR PORTF.OUTCLR
+#define PORTF_OUTTGL PORTF.OUTTGL
+#define PORTF_IN PORTF.IN
+#define PORTF_INTCTRL PORTF.INTCTRL
+#define PORTF_INT0MASK PORTF.INT0MASK
+#define PORTF_INT1MASK PORTF.INT1MASK
+#define PORTF_INTFLAGS PORTF.INTFLAGS
+#define PORTF_PIN0CTRL PORTF.PIN0CTRL
+#define PORTF_PIN1CTRL PORTF.PIN1CTRL
+#define PORTF_PIN2CTRL PORTF.PIN2CTRL
+#define PORTF_PIN3CTRL PORTF.PIN3CTRL
+#define PORTF_PIN4CTRL PORTF.PIN4CTRL
+#define PORTF_PIN5CTRL PORTF.PIN5CTRL
+#define PORTF_PIN6CTRL PORTF.PIN6CTRL
+#define PORTF_PIN7CTRL PORTF.PIN7CTRL
+
+#define PORTH_DIR PORTH.DIR
+#define PORTH_DIRSET PORTH.DIRSET
+#define PORTH_DIRCLR PORTH.DIRCLR
+#define PORTH_DIRTGL PORTH.DIRTGL
+#define PORTH_OUT PORTH.OUT
+#define PORTH_OUTSET PORTH.OUTSET
+#define PORTH_OUTCLR PORTH.OUTCLR
+#define PORTH_OUTTGL PORTH.OUTTGL
+#define PORTH_IN PORTH.IN
+#define PORTH_INTCTRL PORTH.INTCTRL
+#define PORTH_INT0MASK PORTH.INT0MASK
+#define PORTH_INT1MASK PORTH.INT1MASK
+#define PORTH_INTFLAGS PORTH.INTFLAGS
+#define PORTH_PIN0CTRL PORTH.PIN0CTRL
+#define PORTH_PIN1CTRL PORTH.PIN1CTRL
+#define PORTH_PIN2CTRL PORTH.PIN2CTRL
+#define PORTH_PIN3CTRL PORTH.PIN3CTRL
+#define PORTH_PIN4CTRL PORTH.PIN4CTRL
+#define PORTH_PIN5CTRL PORTH.PIN5CTRL
+#define PORTH_PIN6CTRL PORTH.PIN6CTRL
+#define PORTH_PIN7CTRL PORTH.PIN7CTRL
+
+#define PORTJ_DIR PORTJ.DIR
+#define PORTJ_DIRSET PORTJ.DIRSET
+#define PORTJ_DIRCLR PORTJ.DIRCLR
+#define PORTJ_DIRTGL PORTJ.DIRTGL
+#define PORTJ_OUT PORTJ.OUT
+#define PORTJ_OUTSET PORTJ.OUTSET
+#define PORTJ_OUTCLR PORTJ.OUTCLR
+#define PORTJ_OUTTGL PORTJ.OUTTGL
+#define PORTJ_IN PORTJ.IN
+#define PORTJ_INTCTRL PORTJ.INTCTRL
+#define PORTJ_INT0MASK PORTJ.INT0MASK
+#define PORTJ_INT1MASK PORTJ.INT1MASK
+#define PORTJ_INTFLAGS PORTJ.INTFLAGS
+#define PORTJ_PIN0CTRL PORTJ.PIN0CTRL
+#define PORTJ_PIN1CTRL PORTJ.PIN1CTRL
+#define PORTJ_PIN2CTRL PORTJ.PIN2CTRL
+#define PORTJ_PIN3CTRL PORTJ.PIN3CTRL
+#define PORTJ_PIN4CTRL PORTJ.PIN4CTRL
+#define PORTJ_PIN5CTRL PORTJ.PIN5CTRL
+#define PORTJ_PIN6CTRL PORTJ.PIN6CTRL
+#define PORTJ_PIN7CTRL PORTJ.PIN7CTRL
+
+#define TCC0_CTRLA TCC0.CTRLA
+#define TCC0_CTRLB TCC0.CTRLB
+#define TCC0_CTRLC TCC0.CTRLC
+#define TCC0_CTRLD TCC0.CTRLD
+#define TCC0_CTRLE TCC0.CTRLE
+#define TCC0_INTCTRLA TCC0.INTCTRLA
+#define TCC0_INTCTRLB TCC0.INTCTRLB
+#define TCC0_CTRLFCLR TCC0.CTRLFCLR
+#define TCC0_CTRLFSET TCC0.CTRLFSET
+#define TCC0_CTRLGCLR TCC0.CTRLGCLR
+#define TCC0_CTRLGSET TCC0.CTRLGSET
+#define TCC0_INTFLAGS TCC0.INTFLAGS
+#define TCC0_CNT TCC0.CNT
+#define TCC0_PER TCC0.PER
+#define TCC0_CCA TCC0.CCA
+#define TCC0_CCB TCC0.CCB
+#define TCC0_CCC TCC0.CCC
+#define TCC0_CCD TCC0.CCD
+#define TCC0_PERBUF TCC0.PERBUF
+#define TCC0_CCABUF TCC0.CCABUF
+#define TCC0_CCBBUF TCC0.CCBBUF
+#define TCC0_CCCBUF TCC0.CCCBUF
+#define TCC0_CCDBUF TCC0.CCDBUF
+
+#define TCC1_CTRLA TCC1.CTRLA
+#define TCC1_CTRLB TCC1.CTRLB
+#define TCC1_CTRLC TCC1.CTRLC
+#define TCC1_CTRLD TCC1.CTRLD
+#define TCC1_CTRLE TCC1.CTRLE
+#define TCC1_INTCTRLA TCC1.INTCTRLA
+#define TCC1_INTCTRLB TCC1.INTCTRLB
+#define TCC1_CTRLFCLR TCC1.CTRLFCLR
+#define TCC1_CTRLFSET TCC1.CTRLFSET
+#define TCC1_CTRLGCLR TCC1.CTRLGCLR
+#define TCC1_CTRLGSET TCC1.CTRLGSET
+#define TCC1_INTFLAGS TCC1.INTFLAGS
+#define TCC1_CNT TCC1.CNT
+#define TCC1_PER TCC1.PER
+#define TCC1_CCA TCC1.CCA
+#define TCC1_CCB TCC1.CCB
+#define TCC1_CCC TCC1.CCC
+#define TCC1_CCD TCC1.CCD
+#define TCC1_PERBUF TCC1.PERBUF
+#define TCC1_CCABUF TCC1.CCABUF
+#define TCC1_CCBBUF TCC1.CCBBUF
+#define TCC1_CCCBUF TCC1.CCCBUF
+#define TCC1_CCDBUF TCC1.CCDBUF
+
+#define TCD0_CTRLA TCD0.CTRLA
+#define TCD0_CTRLB TCD0.CTRLB
+#define TCD0_CTRLC TCD0.CTRLC
+#define TCD0_CTRLD TCD0.CTRLD
+#define TCD0_CTRLE TCD0.CTRLE
+#define TCD0_INTCTRLA TCD0.INTCTRLA
+#define TCD0_INTCTRLB TCD0.INTCTRLB
+#define TCD0_CTRLFCLR TCD0.CTRLFCLR
+#define TCD0_CTRLFSET TCD0.CTRLFSET
+#define TCD0_CTRLGCLR TCD0.CTRLGCLR
+#define TCD0_CTRLGSET TCD0.CTRLGSET
+#define TCD0_INTFLAGS TCD0.INTFLAGS
+#define TCD0_CNT TCD0.CNT
+#define TCD0_PER TCD0.PER
+#define TCD0_CCA TCD0.CCA
+#define TCD0_CCB TCD0.CCB
+#define TCD0_CCC TCD0.CCC
+#define TCD0_CCD TCD0.CCD
+#define TCD0_PERBUF TCD0.PERBUF
+#define TCD0_CCABUF TCD0.CCABUF
+#define TCD0_CCBBUF TCD0.CCBBUF
+#define TCD0_CCCBUF TCD0.CCCBUF
+#define TCD0_CCDBUF TCD0.CCDBUF
+
+#define TCD1_CTRLA TCD1.CTRLA
+#define TCD1_CTRLB TCD1.CTRLB
+#define TCD1_CTRLC TCD1.CTRLC
+#define TCD1_CTRLD TCD1.CTRLD
+#define TCD1_CTRLE TCD1.CTRLE
+#define TCD1_INTCTRLA TCD1.INTCTRLA
+#define TCD1_INTCTRLB TCD1.INTCTRLB
+#define TCD1_CTRLFCLR TCD1.CTRLFCLR
+#define TCD1_CTRLFSET TCD1.CTRLFSET
+#define TCD1_CTRLGCLR TCD1.CTRLGCLR
+#define TCD1_CTRLGSET TCD1.CTRLGSET
+#define TCD1_INTFLAGS TCD1.INTFLAGS
+#define TCD1_CNT TCD1.CNT
+#define TCD1_PER TCD1.PER
+#define TCD1_CCA TCD1.CCA
+#define TCD1_CCB TCD1.CCB
+#define TCD1_CCC TCD1.CCC
+#define TCD1_CCD TCD1.CCD
+#define TCD1_PERBUF TCD1.PERBUF
+#define TCD1_CCABUF TCD1.CCABUF
+#define TCD1_CCBBUF TCD1.CCBBUF
+#define TCD1_CCCBUF TCD1.CCCBUF
+#define TCD1_CCDBUF TCD1.CCDBUF
+
+#define TCE0_CTRLA TCE0.CTRLA
+#define TCE0_CTRLB TCE0.CTRLB
+#define TCE0_CTRLC TCE0.CTRLC
+#define TCE0_CTRLD TCE0.CTRLD
+#define TCE0_CTRLE TCE0.CTRLE
+#define TCE0_INTCTRLA TCE0.INTCTRLA
+#define TCE0_INTCTRLB TCE0.INTCTRLB
+#define TCE0_CTRLFCLR TCE0.CTRLFCLR
+#define TCE0_CTRLFSET TCE0.CTRLFSET
+#define TCE0_CTRLGCLR TCE0.CTRLGCLR
+#define TCE0_CTRLGSET TCE0.CTRLGSET
+#define TCE0_INTFLAGS TCE0.INTFLAGS
+#define TCE0_CNT TCE0.CNT
+#define TCE0_PER TCE0.PER
+#define TCE0_CCA TCE0.CCA
+#define TCE0_CCB TCE0.CCB
+#define TCE0_CCC TCE0.CCC
+#define TCE0_CCD TCE0.CCD
+#define TCE0_PERBUF TCE0.PERBUF
+#define TCE0_CCABUF TCE0.CCABUF
+#define TCE0_CCBBUF TCE0.CCBBUF
+#define TCE0_CCCBUF TCE0.CCCBUF
+#define TCE0_CCDBUF TCE0.CCDBUF
+
+#define TCE1_CTRLA TCE1.CTRLA
+#define TCE1_CTRLB TCE1.CTRLB
+#define TCE1_CTRLC TCE1.CTRLC
+#define TCE1_CTRLD TCE1.CTRLD
+#define TCE1_CTRLE TCE1.CTRLE
+#define TCE1_INTCTRLA TCE1.INTCTRLA
+#define TCE1_INTCTRLB TCE1.INTCTRLB
+#define TCE1_CTRLFCLR TCE1.CTRLFCLR
+#define TCE1_CTRLFSET TCE1.CTRLFSET
+#define TCE1_CTRLGCLR TCE1.CTRLGCLR
+#define TCE1_CTRLGSET TCE1.CTRLGSET
+#define TCE1_INTFLAGS TCE1.INTFLAGS
+#define TCE1_CNT TCE1.CNT
+#define TCE1_PER TCE1.PER
+#define TCE1_CCA TCE1.CCA
+#define TCE1_CCB TCE1.CCB
+#define TCE1_CCC TCE1.CCC
+#define TCE1_CCD TCE1.CCD
+#define TCE1_PERBUF TCE1.PERBUF
+#define TCE1_CCABUF TCE1.CCABUF
+#define TCE1_CCBBUF TCE1.CCBBUF
+#define TCE1_CCCBUF TCE1.CCCBUF
+#define TCE1_CCDBUF TCE1.CCDBUF
+
+#define TCF0_CTRLA TCF0.CTRLA
+#define TCF0_CTRLB TCF0.CTRLB
+#define TCF0_CTRLC TCF0.CTRLC
+#define TCF0_CTRLD TCF0.CTRLD
+#define TCF0_CTRLE TCF0.CTRLE
+#define TCF0_INTCTRLA TCF0.INTCTRLA
+#define TCF0_INTCTRLB TCF0.INTCTRLB
+#define TCF0_CTRLFCLR TCF0.CTRLFCLR
+#define TCF0_CTRLFSET TCF0.CTRLFSET
+#define TCF0_CTRLGCLR TCF0.CTRLGCLR
+#define TCF0_CTRLGSET TCF0.CTRLGSET
+#define TCF0_INTFLAGS TCF0.INTFLAGS
+#define TCF0_CNT TCF0.CNT
+#define TCF0_PER TCF0.PER
+#define TCF0_CCA TCF0.CCA
+#define TCF0_CCB TCF0.CCB
+#define TCF0_CCC TCF0.CCC
+#define TCF0_CCD TCF0.CCD
+#define TCF0_PERBUF TCF0.PERBUF
+#define TCF0_CCABUF TCF0.CCABUF
+#define TCF0_CCBBUF TCF0.CCBBUF
+#define TCF0_CCCBUF TCF0.CCCBUF
+#define TCF0_CCDBUF TCF0.CCDBUF
+
+#define TCF1_CTRLA TCF1.CTRLA
+#define TCF1_CTRLB TCF1.CTRLB
+#define TCF1_CTRLC TCF1.CTRLC
+#define TCF1_CTRLD TCF1.CTRLD
+#define TCF1_CTRLE TCF1.CTRLE
+#define TCF1_INTCTRLA TCF1.INTCTRLA
+#define TCF1_INTCTRLB TCF1.INTCTRLB
+#define TCF1_CTRLFCLR TCF1.CTRLFCLR
+#define TCF1_CTRLFSET TCF1.CTRLFSET
+#define TCF1_CTRLGCLR TCF1.CTRLGCLR
+#define TCF1_CTRLGSET TCF1.CTRLGSET
+#define TCF1_INTFLAGS TCF1.INTFLAGS
+#define TCF1_CNT TCF1.CNT
+#define TCF1_PER TCF1.PER
+#define TCF1_CCA TCF1.CCA
+#define TCF1_CCB TCF1.CCB
+#define TCF1_CCC TCF1.CCC
+#define TCF1_CCD TCF1.CCD
+#define TCF1_PERBUF TCF1.PERBUF
+#define TCF1_CCABUF TCF1.CCABUF
+#define TCF1_CCBBUF TCF1.CCBBUF
+#define TCF1_CCCBUF TCF1.CCCBUF
+#define TCF1_CCDBUF TCF1.CCDBUF
+
+#define ADCA_CTRLA ADCA.CTRLA
+#define ADCA_CTRLB ADCA.CTRLB
+#define ADCA_REFCTRL ADCA.REFCTRL
+#define ADCA_EVCTRL ADCA.EVCTRL
+#define ADCA_PRESCALER ADCA.PRESCALER
+#define ADCA_INTFLAGS ADCA.INTFLAGS
+#define ADCA_CH0RES ADCA.CH0RES
+#define ADCA_CH1RES ADCA.CH1RES
+#define ADCA_CH2RES ADCA.CH2RES
+#define ADCA_CH3RES ADCA.CH3RES
+#define ADCA_CMP ADCA.CMP
+#define ADCA_CH0_CTRL ADCA.CH0.CTRL
+#define ADCA_CH0_MUXCTRL ADCA.CH0.MUXCTRL
+#define ADCA_CH0_INTCTRL ADCA.CH0.INTCTRL
+#define ADCA_CH0_INTFLAGS ADCA.CH0.INTFLAGS
+#define ADCA_CH0_RES ADCA.CH0.RES
+#define ADCA_CH1_CTRL ADCA.CH1.CTRL
+#define ADCA_CH1_MUXCTRL ADCA.CH1.MUXCTRL
+#define ADCA_CH1_INTCTRL ADCA.CH1.INTCTRL
+#define ADCA_CH1_INTFLAGS ADCA.CH1.INTFLAGS
+#define ADCA_CH1_RES ADCA.CH1.RES
+#define ADCA_CH2_CTRL ADCA.CH2.CTRL
+#define ADCA_CH2_MUXCTRL ADCA.CH2.MUXCTRL
+#define ADCA_CH2_INTCTRL ADCA.CH2.INTCTRL
+#define ADCA_CH2_INTFLAGS ADCA.CH2.INTFLAGS
+#define ADCA_CH2_RES ADCA.CH2.RES
+#define ADCA_CH3_CTRL ADCA.CH3.CTRL
+#define ADCA_CH3_MUXCTRL ADCA.CH3.MUXCTRL
+#define ADCA_CH3_INTCTRL ADCA.CH3.INTCTRL
+#define ADCA_CH3_INTFLAGS ADCA.CH3.INTFLAGS
+#define ADCA_CH3_RES ADCA.CH3.RES
+
+#define ADCB_CTRLA ADCB.CTRLA
+#define ADCB_CTRLB ADCB.CTRLB
+#define ADCB_REFCTRL ADCB.REFCTRL
+#define ADCB_EVCTRL ADCB.EVCTRL
+#define ADCB_PRESCALER ADCB.PRESCALER
+#define ADCB_INTFLAGS ADCB.INTFLAGS
+#define ADCB_CH0RES ADCB.CH0RES
+#define ADCB_CH1RES ADCB.CH1RES
+#define ADCB_CH2RES ADCB.CH2RES
+#define ADCB_CH3RES ADCB.CH3RES
+#define ADCB_CMP ADCB.CMP
+#define ADCB_CH0_CTRL ADCB.CH0.CTRL
+#define ADCB_CH0_MUXCTRL ADCB.CH0.MUXCTRL
+#define ADCB_CH0_INTCTRL ADCB.CH0.INTCTRL
+#define ADCB_CH0_INTFLAGS ADCB.CH0.INTFLAGS
+#define ADCB_CH0_RES ADCB.CH0.RES
+#define ADCB_CH1_CTRL ADCB.CH1.CTRL
+#define ADCB_CH1_MUXCTRL ADCB.CH1.MUXCTRL
+#define ADCB_CH1_INTCTRL ADCB.CH1.INTCTRL
+#define ADCB_CH1_INTFLAGS ADCB.CH1.INTFLAGS
+#define ADCB_CH1_RES ADCB.CH1.RES
+#define ADCB_CH2_CTRL ADCB.CH2.CTRL
+#define ADCB_CH2_MUXCTRL ADCB.CH2.MUXCTRL
+#define ADCB_CH2_INTCTRL ADCB.CH2.INTCTRL
+#define ADCB_CH2_INTFLAGS ADCB.CH2.INTFLAGS
+#define ADCB_CH2_RES ADCB.CH2.RES
+#define ADCB_CH3_CTRL ADCB.CH3.CTRL
+#define ADCB_CH3_MUXCTRL ADCB.CH3.MUXCTRL
+#define ADCB_CH3_INTCTRL ADCB.CH3.INTCTRL
+#define ADCB_CH3_INTFLAGS ADCB.CH3.INTFLAGS
+#define ADCB_CH3_RES ADCB.CH3.RES
+
+#define EVSYS_CH0MUX EVSYS.CH0MUX
+#define EVSYS_CH1MUX EVSYS.CH1MUX
+#define EVSYS_CH2MUX EVSYS.CH2MUX
+#define EVSYS_CH3MUX EVSYS.CH3MUX
+#define EVSYS_CH4MUX EVSYS.CH4MUX
+#define EVSYS_CH5MUX EVSYS.CH5MUX
+#define EVSYS_CH6MUX EVSYS.CH6MUX
+#define EVSYS_CH7MUX EVSYS.CH7MUX
+#define EVSYS_CH0CTRL EVSYS.CH0CTRL
+#define EVSYS_CH1CTRL EVSYS.CH1CTRL
+#define EVSYS_CH2CTRL EVSYS.CH2CTRL
+#define EVSYS_CH3CTRL EVSYS.CH3CTRL
+#define EVSYS_CH4CTRL EVSYS.CH4CTRL
+#define EVSYS_CH5CTRL EVSYS.CH5CTRL
+#define EVSYS_CH6CTRL EVSYS.CH6CTRL
+#define EVSYS_CH7CTRL EVSYS.CH7CTRL
+
+#define PMIC_CTRL PMIC.CTRL
+#define PMIC_STATUS PMIC.STATUS
+#define RST_STATUS RST.STATUS
+#define PORTCFG_MPCMASK PORTCFG.MPCMASK
+
+//bit masks and group configurations
+#define PORT_ISC_LEVEL_gc 0x03
+
+#define PMIC_LOLVLEN_bm 0x01
+#define PMIC_MEDLVLEN_bm 0x02
+#define PMIC_HILVLEN_bm 0x04
+#define PMIC_LOLVLEX_bm 0x01
+#define PMIC_MEDLVLEX_bm 0x02
+#define PMIC_HILVLEX_bm 0x04
+
+#define RST_PORF_bm 0x01
+#define RST_EXTRF_bm 0x02
+#define RST_BORF_bm 0x04
+#define RST_WDRF_bm 0x08
+#define RST_PDIRF_bm 0x10
+#define RST_SRF_bm 0x20
+
+#define CLK_SCLKSEL_RC32M_gc 0x01
+#define CLK_PSADIV_1_gc 0x00
+#define CLK_PSBCDIV_1_1_gc 0x00
+
+#define TC_CLKSEL_gm 0x0F
+#define TC_CLKSEL_OFF_gc 0x00
+#define TC_CLKSEL_DIV1_gc 0x01
+#define TC_CLKSEL_DIV2_gc 0x02
+#define TC_CLKSEL_DIV4_gc 0x03
+#define TC_CLKSEL_DIV8_gc 0x04
+#define TC_CLKSEL_DIV64_gc 0x05
+#define TC_CLKSEL_DIV256_gc 0x06
+#define TC_CLKSEL_DIV1024_gc 0x07
+#define TC_WGMODE_NORMAL_gc 0x00
+#define TC_WGMODE_SS_gc 0x03
+#define TC_WGMODE_DS_B_gc 0x07
+#define TC_EVACT_gm 0xE0
+#define TC_EVACT_QDEC_gc 0x60
+#define TC_EVSEL_CH0_gc 0x08
+#define TC_EVSEL_CH2_gc 0x0A
+#define TC_EVSEL_CH4_gc 0x0C
+#define TC_OVFINTLVL_gm 0x03
+#define TC_OVFINTLVL_LO_gc 0x01
+#define TC0_CCDBV_bm 0x10
+#define TC0_CCCBV_bm 0x08
+#define TC0_CCBBV_bm 0x04
+#define TC0_CCABV_bm 0x02
+#define TC0_LUPD_bm 0x02
+#define TC0_OVFIF_bm 0x01
+#define TC0_CCAIF_bm 0x10
+#define TC0_CCAINTLVL_gm 0x03
+#define TC0_CCBINTLVL_gm 0x0C
+#define TC0_CCCINTLVL_gm 0x30
+#define TC0_CCDINTLVL_gm 0xC0
+#define TC_CCAINTLVL_OFF_gc 0x00
+#define TC_CCAINTLVL_LO_gc 0x01
+#define TC_CCAINTLVL_MED_gc 0x02
+#define TC_CCAINTLVL_HI_gc 0x03
+
+#define AWEX_DTICCAEN_bm 0x01
+#define AWEX_DTICCBEN_bm 0x02
+#define AWEX_DTICCCEN_bm 0x04
+#define AWEX_DTICCDEN_bm 0x08
+
+#define ADC_ENABLE_bm 0x01
+#define ADC_RESOLUTION_12BIT_gc 0x00
+#define ADC_PRESCALER_DIV4_gc 0x00
+#define ADC_CH_INPUTMODE_SINGLEENDED_gc 0x01
+#define ADC_CH_GAIN_1X_gc 0x00
+#define ADC_CH_MUXPOS_gm 0x78
+#define ADC_CH_MUXPOS_PIN0_gc 0x00
+#define ADC_CH_MUXPOS_PIN1_gc 0x08
+#define ADC_CH_MUXPOS_PIN2_gc 0x10
+#define ADC_CH_MUXPOS_PIN3_gc 0x18
+#define ADC_CH_MUXPOS_PIN4_gc 0x20
+#define ADC_CH_MUXPOS_PIN5_gc 0x28
+#define ADC_CH_MUXPOS_PIN6_gc 0x30
+#define ADC_CH_MUXPOS_PIN7_gc 0x38
+#define ADC_EVACT_gm 0x07
+#define ADC_EVACT_NONE_gc 0x00
+#define ADC_EVACT_CH0_gc 0x01
+#define ADC_EVACT_SWEEP_gc 0x05
+#define ADC_EVSEL_gm 0x38
+#define ADC_EVSEL_0123_gc 0x00
+#define ADC_EVSEL_1234_gc 0x08
+#define ADC_SWEEP_gm 0xC0
+#define ADC_SWEEP_0123_gc 0xC0
+
+#define DMA_ENABLE_bm 0x80
+#define DMA_RESET_bm 0x40
+#define DMA_DBUFMODE_gm 0x0C
+#define DMA_DBUFMODE_CH01_gc 0x04
+#define DMA_CH_ENABLE_bm 0x80
+#define DMA_CH_REPEAT_bm 0x20
+#define DMA_CH_SINGLE_bm 0x04
+#define DMA_CH_BURSTLEN_gm 0x03
+#define DMA_CH_BURSTLEN_1BYTE_gc 0x00
+#define DMA_CH_BURSTLEN_8BYTE_gc 0x03
+#define DMA_CH_TRNIF_bm 0x10
+#define DMA_CH_TRNINTLVL_gm 0x03
+#define DMA_CH_TRNINTLVL_LO_gc 0x01
+#define DMA_CH_SRCRELOAD_gm 0xC0
+#define DMA_CH_SRCRELOAD_NONE_gc 0x00
+#define DMA_CH_SRCRELOAD_BLOCK_gc 0x40
+#define DMA_CH_SRCRELOAD_BURST_gc 0x80
+#define DMA_CH_SRCRELOAD_TRANSACTION_gc 0xC0
+#define DMA_CH_SRCDIR_gm 0x30
+#define DMA_CH_SRCDIR_FIXED_gc 0x00
+#define DMA_CH_SRCDIR_INC_gc 0x10
+#define DMA_CH_DESTRELOAD_gm 0x0C
+#define DMA_CH_DESTRELOAD_NONE_gc 0x00
+#define DMA_CH_DESTRELOAD_BLOCK_gc 0x04
+#define DMA_CH_DESTRELOAD_BURST_gc 0x08
+#define DMA_CH_DESTRELOAD_TRANSACTION_gc 0x0C
+#define DMA_CH_DESTDIR_gm 0x03
+#define DMA_CH_DESTDIR_FIXED_gc 0x00
+#define DMA_CH_DESTDIR_INC_gc 0x01
+#define DMA_CH_TRIGSRC_ADCB_CH4_gc 0x24
+#define DMA_CH_TRIGSRC_USARTC0_DRE_gc 0x4C
+
+#define USART_DREIF_bm 0x20
+#define USART_TXEN_bm 0x08
+#define USART_CMODE_ASYNCHRONOUS_gc 0x00
+#define USART_PMODE_DISABLED_gc 0x00
+#define USART_CHSIZE_gm 0x07
+#define USART_CHSIZE_8BIT_gc 0x03
+#define USART_BSCALE_gp 4
+
+#define EVSYS_CHMUX_TCD1_OVF_gc 0xD8
+#define EVSYS_CHMUX_PORTF_PIN0_gc 0x78
+#define EVSYS_CHMUX_PORTF_PIN2_gc 0x7A
+#define EVSYS_CHMUX_PORTF_PIN4_gc 0x7C
+#define EVSYS_QDEN_bm 0x08
+#define EVSYS_DIGFILT_2SAMPLES_gc 0x01
+
+
+#endif /* HOST_AVR_IO_H_ */
@@ -0,0 +1,21 @@
+/*
+ * pgmspace.h
+ *
+ * Created: 10/17/2026 6:33:12 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <avr/pgmspace.h>, flash and RAM are the same address space on the host.
+ *	The reads keep the type of what they point at, so a function pointer in a flash table comes back whole.
+ */
+
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(address))
+#define pgm_read_word(address) (*(address))
+
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
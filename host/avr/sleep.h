@@ -0,0 +1,25 @@
+/*
+ * sleep.h
+ *
+ * Created: 10/17/2026 6:33:40 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <avr/sleep.h>. Sleeping runs the simulated peripherals until an interrupt
+ *	has been handled, which is what moves the virtual clock on.
+ */
+
+
+#ifndef HOST_AVR_SLEEP_H_
+#define HOST_AVR_SLEEP_H_
+
+#define SLEEP_MODE_IDLE 0
+
+void sim_sleep();
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu() sim_sleep()
+
+
+#endif /* HOST_AVR_SLEEP_H_ */
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# kick_check.py
+#
+# Checks the motor start staggering in motor_control.c: the two motors on one H-bridge must never kick from
+# a standstill in the same ramp period. Runs each scenario through the host build with the inputs moved
+# later by a few different amounts and reads the actuator trace:
+#
+#     make -C host && python host/kick_check.py [-n offsets] [scenario ...]
+#
+# The scenarios default to host/scenarios/*.txt and everything in host/scenarios/kick/. A kick is a duty
+# going from 0 to anything else, every trace line is one change of the committed CCx duties so two kicks
+# on the same line happened in the same period. Every clash is printed and the exit status is 1 if any
+# were found.
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+SIMULATOR = os.path.join(HOST_DIR, "escape_robot_host")
+
+# columns of the trace, LF (CCA) and LR (CCB) are driven by one H-bridge, RR (CCC) and RF (CCD) by the other
+MOTORS = ["lf", "lr", "rr", "rf"]
+BRIDGES = [("lf", "lr"), ("rr", "rf")]
+
+# the inputs are moved over one 200ms sample and ramp period pattern, see latency.py
+OFFSET_SPAN_US = 200000
+RUN_MS = 10000
+
+
+def run_trace(scenario, offset_us):
+    output = subprocess.run([SIMULATOR, "-s", scenario, "-o", str(offset_us), "-t", str(RUN_MS)],
+                            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True,
+                            check=True).stdout
+    lines = output.splitlines()
+    header = lines[0].split(",")
+    return [dict(zip(header, line.split(","))) for line in lines[1:]]
+
+
+def clashes(rows):
+    found = []
+    last = None
+    for row in rows:
+        if last is not None:
+            kicked = [motor for motor in MOTORS if int(last[motor]) == 0 and int(row[motor]) != 0]
+            for bridge in BRIDGES:
+                if all(motor in kicked for motor in bridge):
+                    found.append((int(row["time_us"]), bridge))
+        last = row
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser(description="check no two motors on one H-bridge kick in the same period")
+    parser.add_argument("-n", "--offsets", type=int, default=10, help="input offsets per scenario (default 10)")
+    parser.add_argument("scenarios", nargs="*",
+                        default=sorted(glob.glob(os.path.join(HOST_DIR, "scenarios", "*.txt")) +
+                                       glob.glob(os.path.join(HOST_DIR, "scenarios", "kick", "*.txt"))))
+    args = parser.parse_args()
+
+    if not os.path.exists(SIMULATOR):
+        sys.exit("%s not found, run make in %s first" % (SIMULATOR, HOST_DIR))
+
+    failed = 0
+    for scenario in args.scenarios:
+        name = os.path.relpath(scenario, os.path.join(HOST_DIR, "scenarios"))
+        found = 0
+        for i in range(args.offsets):
+            offset_us = i * OFFSET_SPAN_US // args.offsets
+            for time_us, bridge in clashes(run_trace(scenario, offset_us)):
+                print("%s offset %dus: %s and %s kick together at %.1fms" %
+                      (name, offset_us, bridge[0].upper(), bridge[1].upper(), time_us / 1000.0))
+                found += 1
+        print("%s: %s" % (name, "%d clashes" % found if found else "ok"))
+        failed += found
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+#
+# latency.py
+#
+# Measures the end to end latency from something happening in front of the sensors to the firmware
+# changing the motors, by running each latency scenario through the host build many times:
+#
+#     make -C host && python host/latency.py [-n trials] [--csv] [scenario ...]
+#
+# The scenarios default to everything in host/scenarios/latency/. Each has a "stimulus" line that marks
+# when the thing the robot should react to happens. Every trial moves all the inputs later by a different
+# amount, spread evenly over LATENCY_SPAN_US, so the stimulus lands at a different point of the sample and
+# ramp periods each time.
+#
+# For each scenario the p50, p99 and max are printed for two latencies, with a histogram of the first:
+#     command  first write that changes the motor phases on PORTD or the duty in the TCE0 CCxBUF registers
+#     pwm      the new duty reaching the CCx registers at the start of the next PWM period, a phase change alone doesn't count
+# Trials where the motors didn't change at all are counted as missed. --csv prints one machine readable
+# row per scenario and latency instead.
+
+import argparse
+import concurrent.futures
+import glob
+import math
+import os
+import re
+import subprocess
+import sys
+
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+SIMULATOR = os.path.join(HOST_DIR, "escape_robot_host")
+
+# least common multiple of the 100ms sample period and the 40ms ramp period, the latency pattern repeats after this
+LATENCY_SPAN_US = 200000
+
+# longest each trial runs after the last keyframe, the simulator stops as soon as every stimulus has been reacted to
+SETTLE_MS = 1500
+
+HISTOGRAM_BUCKET_US = 10000
+HISTOGRAM_WIDTH = 50
+
+
+def last_keyframe_ms(scenario):
+    last = 0.0
+    with open(scenario) as f:
+        for line in f:
+            fields = line.split("#")[0].split()
+            if len(fields) >= 2:
+                last = max(last, float(fields[1]))
+    return last
+
+
+def run_trial(scenario, offset_us, run_ms):
+    output = subprocess.run([SIMULATOR, "-l", "-s", scenario, "-o", str(offset_us), "-t", str(run_ms)],
+                            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, universal_newlines=True,
+                            check=True).stdout
+    trials = []
+    for line in output.splitlines()[1:]:
+        stimulus_us, command_us, pwm_us = (int(value) for value in line.split(","))
+        trials.append((command_us, pwm_us))
+    return trials
+
+
+def percentile(values, fraction):
+    # nearest rank
+    return values[max(0, math.ceil(fraction * len(values)) - 1)]
+
+
+def summarize(values):
+    measured = sorted(value for value in values if value >= 0)
+    missed = len(values) - len(measured)
+    if not measured:
+        return None, missed
+    return (percentile(measured, 0.50), percentile(measured, 0.99), measured[-1]), missed
+
+
+def print_histogram(values):
+    measured = [value for value in values if value >= 0]
+    if not measured:
+        return
+    first = min(measured) // HISTOGRAM_BUCKET_US
+    buckets = [0] * (max(measured) // HISTOGRAM_BUCKET_US + 1)
+    for value in measured:
+        buckets[value // HISTOGRAM_BUCKET_US] += 1
+    most = max(buckets)
+    for i, count in enumerate(buckets[first:], first):
+        bar = "#" * ((count * HISTOGRAM_WIDTH + most - 1) // most) if count else ""
+        print("  %4d-%-4d ms %5d %s" % (i * HISTOGRAM_BUCKET_US // 1000, (i + 1) * HISTOGRAM_BUCKET_US // 1000,
+                                       count, bar))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="sensor to motor latency of the firmware, run on the host build")
+    parser.add_argument("-n", "--trials", type=int, default=100, help="trials per scenario (default 100)")
+    parser.add_argument("--csv", action="store_true", help="print a machine readable summary")
+    parser.add_argument("scenarios", nargs="*",
+                        default=sorted(glob.glob(os.path.join(HOST_DIR, "scenarios", "latency", "*.txt"))))
+    args = parser.parse_args()
+
+    if not os.path.exists(SIMULATOR):
+        sys.exit("%s not found, run make in %s first" % (SIMULATOR, HOST_DIR))
+
+    if args.csv:
+        print("scenario,latency,trials,missed,p50_us,p99_us,max_us")
+
+    with concurrent.futures.ThreadPoolExecutor(os.cpu_count()) as pool:
+        for scenario in args.scenarios:
+            name = re.sub(r"\.txt$", "", os.path.basename(scenario))
+            run_ms = last_keyframe_ms(scenario) + SETTLE_MS + LATENCY_SPAN_US / 1000
+            offsets = [i * LATENCY_SPAN_US // args.trials for i in range(args.trials)]
+
+            trials = []
+            for result in pool.map(lambda offset: run_trial(scenario, offset, run_ms), offsets):
+                trials.extend(result)
+
+            for kind, values in (("command", [t[0] for t in trials]), ("pwm", [t[1] for t in trials])):
+                stats, missed = summarize(values)
+                if args.csv:
+                    if stats:
+                        print("%s,%s,%d,%d,%d,%d,%d" % ((name, kind, len(values), missed) + stats))
+                    else:
+                        print("%s,%s,%d,%d,,," % (name, kind, len(values), missed))
+                    continue
+
+                if kind == "command":
+                    print("%s (%d trials)" % (name, len(values)))
+                if stats:
+                    print("  %-8s p50 %7.1fms  p99 %7.1fms  max %7.1fms  missed %d" %
+                          (kind, stats[0] / 1000.0, stats[1] / 1000.0, stats[2] / 1000.0, missed))
+                else:
+                    print("  %-8s missed %d" % (kind, missed))
+                if kind == "pwm":
+                    print_histogram([t[0] for t in trials])
+                    print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,901 @@
+/*
+ * sim.c
+ *
+ * Created: 10/17/2026 6:41:02 PM
+ *  Author: Clint
+ *
+ *	Peripheral model and virtual clock for the host build. The firmware runs unchanged on top of the register
+ *	structs in avr/io.h, its main() is renamed to firmware_main() and called from here. Time only moves on while
+ *	the firmware sleeps (or polls a register), so code between interrupts takes no virtual time and every run of
+ *	the same scenario gives the same result.
+ *
+ *	Every simulated microsecond the timers count, overflows and compare matches raise their interrupts, the event
+ *	system starts ADC conversions, finished sweeps trigger the DMA, the wheel model moves the encoders and USARTC0
+ *	asks the DMA for its next byte. Pending interrupts are then handled highest level first, each ISR is called
+ *	like a normal function.
+ *
+ *	Usage: escape_robot_host [-t ms] [-s scenario] [-o us] [-q] [-l] [-T file]
+ *		-t	how long to simulate, default 10000ms
+ *		-s	scenario file with the sensor, battery and button inputs, see scenarios/ (default is a threat
+ *			approaching from the front)
+ *		-o	move every keyframe after time 0 this much later, to change when the inputs change relative to
+ *			the sample and ramp timers
+ *		-q	don't print the actuator trace
+ *		-l	print the latency from each stimulus in the scenario to the actuators changing instead of the trace
+ *		-T	write the bytes sent out of USARTC0 (the telemetry stream) to this file, - is stdout (use -q
+ *			with it). Decode it with tools/telemetry_decode.py
+ *
+ *	The actuator trace (stdout, CSV) has a line whenever the motor phases on PORTD or the duty cycles in TCE0
+ *	change. A summary with the number of times each ISR ran is printed to stderr at the end.
+ *
+ *	In latency mode there is a line for each stimulus with the time from it to the first change the firmware
+ *	writes to the motor phases or the CCxBUF registers (command), and to the new duty reaching the CCx registers
+ *	at the next PWM period (pwm), which only looks at CCx and not the phases. -1 if nothing changed before the
+ *	next stimulus or the end of the run.
+ */
+
+#include "sim.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//peripheral instances used by the firmware through avr/io.h
+PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTF, PORTH, PORTJ;
+TC0_t TCC0, TCC1, TCD0, TCD1, TCE0, TCE1, TCF0, TCF1;
+AWEX_t AWEXE;
+ADC_t ADCA, ADCB;
+DMA_t DMA;
+USART_t USARTC0;
+EVSYS_t EVSYS;
+PMIC_t PMIC;
+RST_t RST;
+PORTCFG_t PORTCFG;
+
+volatile uint8_t sim_sreg_i = 0;
+
+//firmware globals shown in the trace
+extern volatile uint8_t state;
+
+int firmware_main(void);
+
+//////////	interrupt vectors, in XMEGA vector order which sets the priority within a level
+
+typedef void (*simIsr_t)(void);
+
+struct simVector_t
+{
+	const char *name;
+	simIsr_t isr;
+	uint8_t pending;
+	uint32_t count;
+};
+
+enum
+{
+	VEC_PORTJ_INT0, VEC_DMA_CH0, VEC_DMA_CH1, VEC_TCC0_OVF, VEC_TCC0_CCA, VEC_TCC0_CCB, VEC_TCC0_CCC, VEC_TCC0_CCD,
+	VEC_TCC1_OVF, VEC_ADCA_CH0, VEC_TCD0_OVF, VEC_TCD0_CCA, VEC_TCD0_CCB, VEC_TCD0_CCC, VEC_TCD0_CCD, VEC_TCD1_OVF,
+	VEC_ADCB_CH0, VEC_ADCB_CH1, VEC_ADCB_CH2, VEC_ADCB_CH3, VEC_TCE0_OVF, VEC_TCE1_OVF, VEC_TCF0_OVF, VEC_TCF1_OVF,
+	NUM_VECTORS
+};
+
+#define SIM_VECTOR_ENTRY(vector) { #vector, vector, 0, 0 }
+
+static struct simVector_t simVectors[NUM_VECTORS] =
+{
+	[VEC_PORTJ_INT0] = SIM_VECTOR_ENTRY(PORTJ_INT0_vect),
+	[VEC_DMA_CH0] = SIM_VECTOR_ENTRY(DMA_CH0_vect),
+	[VEC_DMA_CH1] = SIM_VECTOR_ENTRY(DMA_CH1_vect),
+	[VEC_TCC0_OVF] = SIM_VECTOR_ENTRY(TCC0_OVF_vect),
+	[VEC_TCC0_CCA] = SIM_VECTOR_ENTRY(TCC0_CCA_vect),
+	[VEC_TCC0_CCB] = SIM_VECTOR_ENTRY(TCC0_CCB_vect),
+	[VEC_TCC0_CCC] = SIM_VECTOR_ENTRY(TCC0_CCC_vect),
+	[VEC_TCC0_CCD] = SIM_VECTOR_ENTRY(TCC0_CCD_vect),
+	[VEC_TCC1_OVF] = SIM_VECTOR_ENTRY(TCC1_OVF_vect),
+	[VEC_ADCA_CH0] = SIM_VECTOR_ENTRY(ADCA_CH0_vect),
+	[VEC_TCD0_OVF] = SIM_VECTOR_ENTRY(TCD0_OVF_vect),
+	[VEC_TCD0_CCA] = SIM_VECTOR_ENTRY(TCD0_CCA_vect),
+	[VEC_TCD0_CCB] = SIM_VECTOR_ENTRY(TCD0_CCB_vect),
+	[VEC_TCD0_CCC] = SIM_VECTOR_ENTRY(TCD0_CCC_vect),
+	[VEC_TCD0_CCD] = SIM_VECTOR_ENTRY(TCD0_CCD_vect),
+	[VEC_TCD1_OVF] = SIM_VECTOR_ENTRY(TCD1_OVF_vect),
+	[VEC_ADCB_CH0] = SIM_VECTOR_ENTRY(ADCB_CH0_vect),
+	[VEC_ADCB_CH1] = SIM_VECTOR_ENTRY(ADCB_CH1_vect),
+	[VEC_ADCB_CH2] = SIM_VECTOR_ENTRY(ADCB_CH2_vect),
+	[VEC_ADCB_CH3] = SIM_VECTOR_ENTRY(ADCB_CH3_vect),
+	[VEC_TCE0_OVF] = SIM_VECTOR_ENTRY(TCE0_OVF_vect),
+	[VEC_TCE1_OVF] = SIM_VECTOR_ENTRY(TCE1_OVF_vect),
+	[VEC_TCF0_OVF] = SIM_VECTOR_ENTRY(TCF0_OVF_vect),
+	[VEC_TCF1_OVF] = SIM_VECTOR_ENTRY(TCF1_OVF_vect),
+};
+
+//////////	simulator state
+
+struct simTimer_t
+{
+	TC0_t *tc;
+	uint8_t ovf_vector;
+	
+	//first compare vector, 0xFF if the timer has no compare interrupts in the model
+	uint8_t cc_vector;
+	
+	//event system source code for the overflow
+	uint8_t event_source;
+	
+	uint32_t prescale_cycles;
+	uint16_t last_perbuf;
+	
+	//position of the wheel decoded by this timer in encoder counts
+	double wheel_position;
+};
+
+static struct simTimer_t simTimers[] =
+{
+	{&TCC0, VEC_TCC0_OVF, VEC_TCC0_CCA, 0xC0, 0, 0, 0},
+	{&TCC1, VEC_TCC1_OVF, 0xFF, 0xC8, 0, 0, 0},
+	{&TCD0, VEC_TCD0_OVF, VEC_TCD0_CCA, 0xD0, 0, 0, 0},
+	{&TCD1, VEC_TCD1_OVF, 0xFF, 0xD8, 0, 0, 0},
+	{&TCE0, VEC_TCE0_OVF, 0xFF, 0xE0, 0, 0, 0},
+	{&TCE1, VEC_TCE1_OVF, 0xFF, 0xE8, 0, 0, 0},
+	{&TCF0, VEC_TCF0_OVF, 0xFF, 0xF0, 0, 0, 0},
+	{&TCF1, VEC_TCF1_OVF, 0xFF, 0xF8, 0, 0, 0},
+};
+
+#define NUM_SIM_TIMERS (sizeof(simTimers) / sizeof(simTimers[0]))
+
+struct simAdc_t
+{
+	ADC_t *adc;
+	uint8_t ch_vector;
+	
+	//channels converting, and the cycle the current sweep finishes on
+	uint8_t converting;
+	uint64_t done_cycles;
+};
+
+static struct simAdc_t simAdcs[] =
+{
+	{&ADCA, VEC_ADCA_CH0, 0, 0},
+	{&ADCB, VEC_ADCB_CH0, 0, 0},
+};
+
+static uint64_t simCycles = 0;
+static uint64_t simEndCycles = 10000ULL * (SIM_CPU_HZ / 1000);
+static uint8_t simTrace = 1;
+static uint8_t simLatencyMode = 0;
+
+//where each DMA channel reads and writes next and the bytes done in the current block, the addresses are
+//loaded from the channel registers when it is enabled
+struct simDmaChannel_t
+{
+	volatile uint8_t *src;
+	volatile uint8_t *dest;
+	uint16_t count;
+	uint8_t loaded;
+};
+
+static struct simDmaChannel_t simDma[4];
+
+//the cycle USARTC0 can take its next byte on, and where the bytes go
+static uint64_t simUsartReady = 0;
+static FILE *simUsartOut = 0;
+
+//wheel speeds in encoder counts per second, indexed by TCE0 channel
+static double simWheelSpeed[4];
+
+static struct simKeyframe_t simKeys[SIM_MAX_KEYFRAMES];
+static uint16_t simNumKeys = 0;
+static uint64_t simButtonRelease = 0;
+static uint16_t simNextButton = 0;
+
+//last actuator values written to the trace
+static int16_t simLastPhase = -1;
+static uint16_t simLastDuty[4];
+static uint32_t simActuatorChanges = 0;
+
+//latency mode, the actuators when the last stimulus happened and how long each stimulus took to change them
+struct simLatency_t
+{
+	uint64_t stimulus_us;
+	int64_t command_us;
+	int64_t pwm_us;
+};
+
+static struct simLatency_t simLatency[SIM_MAX_KEYFRAMES];
+static uint16_t simNumStimuli = 0;
+static uint16_t simNextStimulus = 0;
+static uint8_t simStimulusPhase;
+static uint16_t simStimulusCommand[4];
+static uint16_t simStimulusDuty[4];
+
+//////////	scenario
+
+static void sim_add_key(uint8_t kind, double time_ms, uint16_t v0, uint16_t v1, uint16_t v2, uint16_t v3)
+{
+	if(simNumKeys == SIM_MAX_KEYFRAMES)
+	{
+		fprintf(stderr, "sim: too many keyframes\n");
+		exit(1);
+	}
+	
+	simKeys[simNumKeys].kind = kind;
+	simKeys[simNumKeys].time_us = (uint64_t)(time_ms * 1000.0);
+	simKeys[simNumKeys].value[0] = v0;
+	simKeys[simNumKeys].value[1] = v1;
+	simKeys[simNumKeys].value[2] = v2;
+	simKeys[simNumKeys].value[3] = v3;
+	simNumKeys++;
+}
+
+//a quiet room, then something approaching the front sensor and backing off again
+static void sim_default_scenario()
+{
+	sim_add_key(SIM_KEY_BATTERY, 0, 7400, 0, 0, 0);
+	sim_add_key(SIM_KEY_SENSORS, 0, 200, 200, 200, 200);
+	sim_add_key(SIM_KEY_SENSORS, 1000, 200, 200, 200, 200);
+	sim_add_key(SIM_KEY_SENSORS, 2500, 200, 2500, 200, 200);
+	sim_add_key(SIM_KEY_SENSORS, 4000, 200, 2500, 200, 200);
+	sim_add_key(SIM_KEY_SENSORS, 5000, 200, 200, 200, 200);
+}
+
+//lines are "sensors <ms> <left> <front> <back> <right>", "battery <ms> <mV>", "button <ms> <1-8>" or "stimulus <ms>",
+//# starts a comment. A stimulus marks when something the robot should react to happens, for latency mode
+static void sim_load_scenario(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[256];
+	unsigned line_number = 0;
+	
+	if(!f)
+	{
+		perror(path);
+		exit(1);
+	}
+	
+	while(fgets(line, sizeof(line), f))
+	{
+		char kind[16];
+		double ms;
+		unsigned v[4];
+		
+		line_number++;
+		
+		char *comment = strchr(line, '#');
+		if(comment) *comment = 0;
+		
+		if(sscanf(line, "%15s", kind) != 1) continue;
+		
+		if(!strcmp(kind, "sensors") && sscanf(line, "%*s %lf %u %u %u %u", &ms, &v[0], &v[1], &v[2], &v[3]) == 5)
+		{
+			sim_add_key(SIM_KEY_SENSORS, ms, v[0], v[1], v[2], v[3]);
+		}
+		else if(!strcmp(kind, "battery") && sscanf(line, "%*s %lf %u", &ms, &v[0]) == 2)
+		{
+			sim_add_key(SIM_KEY_BATTERY, ms, v[0], 0, 0, 0);
+		}
+		else if(!strcmp(kind, "button") && sscanf(line, "%*s %lf %u", &ms, &v[0]) == 2 && v[0] >= 1 && v[0] <= 8)
+		{
+			sim_add_key(SIM_KEY_BUTTON, ms, v[0], 0, 0, 0);
+		}
+		else if(!strcmp(kind, "stimulus") && sscanf(line, "%*s %lf", &ms) == 1)
+		{
+			sim_add_key(SIM_KEY_STIMULUS, ms, 0, 0, 0, 0);
+		}
+		else
+		{
+			fprintf(stderr, "%s:%u: can't read \"%s\"\n", path, line_number, kind);
+			exit(1);
+		}
+	}
+	
+	fclose(f);
+}
+
+//value of an input at the current time, interpolated between the keyframes either side
+static double sim_input(uint8_t kind, uint8_t index)
+{
+	uint64_t now = sim_time_us();
+	const struct simKeyframe_t *before = 0;
+	const struct simKeyframe_t *after = 0;
+	
+	for(uint16_t i = 0; i < simNumKeys; i++)
+	{
+		if(simKeys[i].kind != kind) continue;
+		
+		if(simKeys[i].time_us <= now && (!before || simKeys[i].time_us >= before->time_us)) before = &simKeys[i];
+		if(simKeys[i].time_us > now && (!after || simKeys[i].time_us < after->time_us)) after = &simKeys[i];
+	}
+	
+	if(!before && !after) return 0;
+	if(!before) return after->value[index];
+	if(!after) return before->value[index];
+	
+	double fraction = (double)(now - before->time_us) / (double)(after->time_us - before->time_us);
+	
+	return before->value[index] + fraction * ((double)after->value[index] - before->value[index]);
+}
+
+//voltage on an ADC pin as a 12 bit result
+static uint16_t sim_adc_pin(ADC_t *adc, uint8_t pin)
+{
+	double counts = 0;
+	
+	if(adc == &ADCB && pin < 4)
+	{
+		counts = sim_input(SIM_KEY_SENSORS, pin);
+	}
+	else if(adc == &ADCA && pin == 1)
+	{
+		counts = sim_input(SIM_KEY_BATTERY, 0) * 4096.0 / SIM_BATTERY_MV_FULL_SCALE + SIM_BATTERY_ADC_OFFSET;
+	}
+	
+	if(counts < 0) counts = 0;
+	if(counts > 4095) counts = 4095;
+	
+	return (uint16_t)counts;
+}
+
+//////////	peripherals
+
+static void sim_pend(uint8_t vector, uint8_t level)
+{
+	if(level) simVectors[vector].pending = level;
+}
+
+//moves one burst on the enabled channel waiting for this trigger, returns 1 if a channel took it
+static uint8_t sim_dma_trigger(uint8_t trigsrc)
+{
+	DMA_CH_t *channels[4] = {&DMA.CH0, &DMA.CH1, &DMA.CH2, &DMA.CH3};
+	
+	if(!(DMA.CTRL & DMA_ENABLE_bm)) return 0;
+	
+	for(uint8_t n = 0; n < 4; n++)
+	{
+		DMA_CH_t *ch = channels[n];
+		struct simDmaChannel_t *sim_ch = &simDma[n];
+		
+		if(!(ch->CTRLA & DMA_CH_ENABLE_bm) || ch->TRIGSRC != trigsrc) continue;
+		
+		if(!sim_ch->loaded)
+		{
+			sim_ch->src = (volatile uint8_t *)ch->host_srcaddr;
+			sim_ch->dest = (volatile uint8_t *)ch->host_destaddr;
+			sim_ch->count = 0;
+			sim_ch->loaded = 1;
+		}
+		
+		uint8_t burst = 1 << (ch->CTRLA & DMA_CH_BURSTLEN_gm);
+		uint8_t addrctrl = ch->ADDRCTRL;
+		uint8_t src_reload = addrctrl & DMA_CH_SRCRELOAD_gm;
+		uint8_t dest_reload = addrctrl & DMA_CH_DESTRELOAD_gm;
+		
+		for(uint8_t i = 0; i < burst; i++)
+		{
+			*sim_ch->dest = *sim_ch->src;
+			if((addrctrl & DMA_CH_SRCDIR_gm) == DMA_CH_SRCDIR_INC_gc) sim_ch->src++;
+			if((addrctrl & DMA_CH_DESTDIR_gm) == DMA_CH_DESTDIR_INC_gc) sim_ch->dest++;
+		}
+		
+		sim_ch->count += burst;
+		
+		if(src_reload == DMA_CH_SRCRELOAD_BURST_gc) sim_ch->src = (volatile uint8_t *)ch->host_srcaddr;
+		if(dest_reload == DMA_CH_DESTRELOAD_BURST_gc) sim_ch->dest = (volatile uint8_t *)ch->host_destaddr;
+		
+		//TRFCNT of 0 is a 64k block
+		if(sim_ch->count >= (ch->TRFCNT ? ch->TRFCNT : 0x10000))
+		{
+			sim_ch->count = 0;
+			
+			//block and transaction reloads are the same thing here, REPCNT isn't modelled
+			if(src_reload == DMA_CH_SRCRELOAD_BLOCK_gc || src_reload == DMA_CH_SRCRELOAD_TRANSACTION_gc)
+				sim_ch->src = (volatile uint8_t *)ch->host_srcaddr;
+			if(dest_reload == DMA_CH_DESTRELOAD_BLOCK_gc || dest_reload == DMA_CH_DESTRELOAD_TRANSACTION_gc)
+				sim_ch->dest = (volatile uint8_t *)ch->host_destaddr;
+			
+			ch->CTRLB |= DMA_CH_TRNIF_bm;
+			
+			//only channels 0 and 1 have their vectors in the table, nothing uses the others' interrupts
+			if(n < 2) sim_pend(n ? VEC_DMA_CH1 : VEC_DMA_CH0, ch->CTRLB & DMA_CH_TRNINTLVL_gm);
+			
+			//in double buffer mode the other channel takes over, otherwise only repeat keeps the channel going
+			if(n < 2 && (DMA.CTRL & DMA_DBUFMODE_gm) == DMA_DBUFMODE_CH01_gc)
+			{
+				ch->CTRLA &= ~DMA_CH_ENABLE_bm;
+				sim_ch->loaded = 0;
+				channels[!n]->CTRLA |= DMA_CH_ENABLE_bm;
+			}
+			else if(!(ch->CTRLA & DMA_CH_REPEAT_bm))
+			{
+				ch->CTRLA &= ~DMA_CH_ENABLE_bm;
+				sim_ch->loaded = 0;
+			}
+		}
+		
+		//only one channel takes each trigger
+		return 1;
+	}
+	
+	return 0;
+}
+
+//USARTC0 only sends what the DMA writes to DATA, one frame (10 bit times at 8N1) per byte
+static void sim_usart_step()
+{
+	if(!(USARTC0.CTRLB & USART_TXEN_bm) || simCycles < simUsartReady) return;
+	
+	USARTC0.STATUS |= USART_DREIF_bm;
+	
+	if(!sim_dma_trigger(DMA_CH_TRIGSRC_USARTC0_DRE_gc)) return;
+	
+	//BSCALE is 4 bits signed, fbaud = fper / (16 * (BSEL * 2^BSCALE + 1))
+	uint16_t bsel = USARTC0.BAUDCTRLA | ((USARTC0.BAUDCTRLB & 0x0F) << 8);
+	int8_t bscale = (int8_t)(USARTC0.BAUDCTRLB & 0xF0) >> 4;
+	double baud = SIM_CPU_HZ / (16.0 * (ldexp(bsel, bscale) + 1));
+	
+	simUsartReady = simCycles + (uint64_t)(10 * SIM_CPU_HZ / baud);
+	
+	if(simUsartOut) fputc(USARTC0.DATA, simUsartOut);
+}
+
+//starts conversions on any ADC listening to the event channel
+static void sim_event(uint8_t channel)
+{
+	for(uint8_t a = 0; a < 2; a++)
+	{
+		struct simAdc_t *sim_adc = &simAdcs[a];
+		ADC_t *adc = sim_adc->adc;
+		uint8_t first = (adc->EVCTRL & ADC_EVSEL_gm) >> 3;
+		uint8_t action = adc->EVCTRL & ADC_EVACT_gm;
+		
+		if(!(adc->CTRLA & ADC_ENABLE_bm) || action == ADC_EVACT_NONE_gc || channel != first || sim_adc->converting) continue;
+		
+		uint8_t channels = (action == ADC_EVACT_SWEEP_gc) ? (1 << (((adc->EVCTRL & ADC_SWEEP_gm) >> 6) + 1)) - 1 : 0x01;
+		uint8_t count = 0;
+		
+		for(uint8_t ch = 0; ch < 4; ch++) if(channels & (1 << ch)) count++;
+		
+		sim_adc->converting = channels;
+		sim_adc->done_cycles = simCycles + (uint64_t)count * SIM_ADC_CONVERSION_CYCLES;
+	}
+}
+
+static void sim_event_source(uint8_t source)
+{
+	volatile uint8_t *mux = &EVSYS.CH0MUX;
+	
+	for(uint8_t channel = 0; channel < 8; channel++)
+	{
+		if(mux[channel] == source) sim_event(channel);
+	}
+}
+
+static void sim_adc_step()
+{
+	for(uint8_t a = 0; a < 2; a++)
+	{
+		struct simAdc_t *sim_adc = &simAdcs[a];
+		ADC_t *adc = sim_adc->adc;
+		ADC_CH_t *chs[4] = {&adc->CH0, &adc->CH1, &adc->CH2, &adc->CH3};
+		register16_t *res[4] = {&adc->CH0RES, &adc->CH1RES, &adc->CH2RES, &adc->CH3RES};
+		
+		if(!sim_adc->converting || simCycles < sim_adc->done_cycles) continue;
+		
+		for(uint8_t ch = 0; ch < 4; ch++)
+		{
+			if(!(sim_adc->converting & (1 << ch))) continue;
+			
+			uint16_t result = sim_adc_pin(adc, (chs[ch]->MUXCTRL & ADC_CH_MUXPOS_gm) >> 3);
+			
+			chs[ch]->RES = result;
+			*res[ch] = result;
+			sim_pend(sim_adc->ch_vector + ch, chs[ch]->INTCTRL & 0x03);
+		}
+		
+		sim_adc->converting = 0;
+		
+		//ADCB_CH4 is the DMA trigger for all channels of a sweep being done
+		if(adc == &ADCB) sim_dma_trigger(DMA_CH_TRIGSRC_ADCB_CH4_gc);
+	}
+}
+
+//raises the compare interrupts for every compare value the count passed through, from after old up to new
+static void sim_compare(struct simTimer_t *timer, uint16_t old, uint16_t new)
+{
+	TC0_t *tc = timer->tc;
+	uint16_t cc[4] = {tc->CCA, tc->CCB, tc->CCC, tc->CCD};
+	
+	if(timer->cc_vector == 0xFF) return;
+	
+	for(uint8_t n = 0; n < 4; n++)
+	{
+		if(cc[n] > old && cc[n] <= new) sim_pend(timer->cc_vector + n, (tc->INTCTRLB >> (2 * n)) & 0x03);
+	}
+}
+
+static void sim_overflow(struct simTimer_t *timer)
+{
+	TC0_t *tc = timer->tc;
+	
+	//buffered registers are loaded on the update condition
+	if(tc->PERBUF != timer->last_perbuf)
+	{
+		tc->PER = tc->PERBUF;
+		timer->last_perbuf = tc->PERBUF;
+	}
+	
+	tc->CCA = tc->CCABUF;
+	tc->CCB = tc->CCBBUF;
+	tc->CCC = tc->CCCBUF;
+	tc->CCD = tc->CCDBUF;
+	
+	sim_pend(timer->ovf_vector, tc->INTCTRLA & TC_OVFINTLVL_gm);
+	sim_event_source(timer->event_source);
+	
+	//a compare at 0 matches as the count wraps
+	if(timer->cc_vector != 0xFF)
+	{
+		uint16_t cc[4] = {tc->CCA, tc->CCB, tc->CCC, tc->CCD};
+		
+		for(uint8_t n = 0; n < 4; n++)
+		{
+			if(!cc[n]) sim_pend(timer->cc_vector + n, (tc->INTCTRLB >> (2 * n)) & 0x03);
+		}
+	}
+}
+
+//moves the wheel on the encoder decoded by a timer and sets the count
+static void sim_quadrature(struct simTimer_t *timer)
+{
+	volatile uint8_t *mux = &EVSYS.CH0MUX;
+	uint8_t channel = (timer->tc->CTRLD & 0x07);
+	uint8_t pin = mux[channel] - EVSYS_CHMUX_PORTF_PIN0_gc;
+	
+	if(pin > 7) return;
+	
+	uint8_t wheel = pin / 2;
+	
+	timer->wheel_position += simWheelSpeed[wheel] * SIM_STEP_CYCLES / SIM_CPU_HZ;
+	timer->tc->CNT = (uint16_t)(int64_t)floor(timer->wheel_position);
+}
+
+static void sim_timer_step(struct simTimer_t *timer)
+{
+	static const uint16_t prescale[8] = {0, 1, 2, 4, 8, 64, 256, 1024};
+	TC0_t *tc = timer->tc;
+	uint16_t div = prescale[tc->CTRLA & 0x07];
+	
+	if((tc->CTRLD & TC_EVACT_gm) == TC_EVACT_QDEC_gc)
+	{
+		sim_quadrature(timer);
+		return;
+	}
+	
+	if(!div) return;
+	
+	timer->prescale_cycles += SIM_STEP_CYCLES;
+	
+	uint32_t ticks = timer->prescale_cycles / div;
+	timer->prescale_cycles -= ticks * div;
+	
+	while(ticks)
+	{
+		uint32_t to_top = (uint32_t)tc->PER - tc->CNT + 1;
+		
+		if(ticks >= to_top)
+		{
+			sim_compare(timer, tc->CNT, tc->PER);
+			tc->CNT = 0;
+			ticks -= to_top;
+			sim_overflow(timer);
+		}
+		else
+		{
+			sim_compare(timer, tc->CNT, tc->CNT + ticks);
+			tc->CNT += ticks;
+			ticks = 0;
+		}
+	}
+}
+
+//motors follow their duty with a first order lag, faster on a fuller pack
+static void sim_wheel_step()
+{
+	volatile uint16_t *cc = &TCE0.CCA;
+	double battery = sim_input(SIM_KEY_BATTERY, 0);
+	double dt = (double)SIM_STEP_CYCLES / SIM_CPU_HZ;
+	
+	if(battery <= 0) battery = SIM_WHEEL_NOMINAL_MV;
+	
+	for(uint8_t wheel = 0; wheel < 4; wheel++)
+	{
+		double duty = 0;
+		
+		if(TCE0.PER && (TCE0.CTRLB & (0x10 << wheel))) duty = (double)cc[wheel] / TCE0.PER;
+		if(duty > 1) duty = 1;
+		if(!(PORTD.OUT & (1 << wheel))) duty = -duty;
+		
+		double target = duty * SIM_WHEEL_COUNTS_PER_S * battery / SIM_WHEEL_NOMINAL_MV;
+		
+		simWheelSpeed[wheel] += (target - simWheelSpeed[wheel]) * dt / SIM_WHEEL_TAU_S;
+	}
+}
+
+static void sim_button_step()
+{
+	uint64_t now = sim_time_us();
+	
+	if(simButtonRelease && now >= simButtonRelease)
+	{
+		PORTJ.IN = 0;
+		simButtonRelease = 0;
+	}
+	
+	for(; simNextButton < simNumKeys; simNextButton++)
+	{
+		struct simKeyframe_t *key = &simKeys[simNextButton];
+		
+		if(key->kind != SIM_KEY_BUTTON) continue;
+		if(key->time_us > now) break;
+		
+		uint8_t mask = 1 << (key->value[0] - 1);
+		
+		PORTJ.IN = mask;
+		simButtonRelease = now + SIM_BUTTON_US;
+		if(PORTJ.INT0MASK & mask) sim_pend(VEC_PORTJ_INT0, PORTJ.INTCTRL & 0x03);
+	}
+}
+
+static void sim_trace_actuators()
+{
+	uint16_t duty[4] = {TCE0.CCA, TCE0.CCB, TCE0.CCC, TCE0.CCD};
+	uint8_t phase = PORTD.OUT & 0x0F;
+	
+	if(phase == simLastPhase && !memcmp(duty, simLastDuty, sizeof(duty))) return;
+	
+	simLastPhase = phase;
+	memcpy(simLastDuty, duty, sizeof(duty));
+	simActuatorChanges++;
+	
+	if(simTrace)
+	{
+		printf("%llu,%u,0x%X,%u,%u,%u,%u\n", (unsigned long long)sim_time_us(), state, phase, duty[0], duty[1], duty[2], duty[3]);
+	}
+}
+
+static void sim_finish();
+
+//starts timing each stimulus when it happens, and stops at the first change to the actuators after it
+static void sim_latency_step()
+{
+	uint64_t now = sim_time_us();
+	uint16_t command[4] = {TCE0.CCABUF, TCE0.CCBBUF, TCE0.CCCBUF, TCE0.CCDBUF};
+	uint16_t duty[4] = {TCE0.CCA, TCE0.CCB, TCE0.CCC, TCE0.CCD};
+	uint8_t phase = PORTD.OUT & 0x0F;
+	
+	for(; simNextStimulus < simNumKeys; simNextStimulus++)
+	{
+		struct simKeyframe_t *key = &simKeys[simNextStimulus];
+		
+		if(key->kind != SIM_KEY_STIMULUS) continue;
+		if(key->time_us > now) break;
+		
+		simLatency[simNumStimuli].stimulus_us = key->time_us;
+		simLatency[simNumStimuli].command_us = -1;
+		simLatency[simNumStimuli].pwm_us = -1;
+		simNumStimuli++;
+		
+		simStimulusPhase = phase;
+		memcpy(simStimulusCommand, command, sizeof(command));
+		memcpy(simStimulusDuty, duty, sizeof(duty));
+	}
+	
+	if(!simNumStimuli) return;
+	
+	struct simLatency_t *latency = &simLatency[simNumStimuli - 1];
+	uint8_t phase_changed = phase != simStimulusPhase;
+	
+	if(latency->command_us < 0 && (phase_changed || memcmp(command, simStimulusCommand, sizeof(command))))
+	{
+		latency->command_us = now - latency->stimulus_us;
+	}
+	
+	//the phases follow the duty out so only the committed duty counts, a phase flip on its own isn't the PWM changing
+	if(latency->pwm_us < 0 && memcmp(duty, simStimulusDuty, sizeof(duty)))
+	{
+		latency->pwm_us = now - latency->stimulus_us;
+	}
+	
+	//nothing left to measure once every stimulus has been reacted to, a normal run carries on to its end time
+	if(simLatencyMode && simNextStimulus == simNumKeys && latency->command_us >= 0 && latency->pwm_us >= 0) sim_finish();
+}
+
+//runs the pending interrupts that are enabled, highest level first then in vector order. Returns how many ran
+static uint32_t sim_dispatch()
+{
+	uint32_t handled = 0;
+	
+	while(sim_sreg_i)
+	{
+		int8_t next = -1;
+		
+		for(uint8_t level = 3; level > 0 && next < 0; level--)
+		{
+			if(!(PMIC.CTRL & (1 << (level - 1)))) continue;
+			
+			for(uint8_t v = 0; v < NUM_VECTORS; v++)
+			{
+				if(simVectors[v].pending == level)
+				{
+					next = v;
+					break;
+				}
+			}
+		}
+		
+		if(next < 0) break;
+		
+		struct simVector_t *vector = &simVectors[next];
+		
+		vector->pending = 0;
+		vector->count++;
+		handled++;
+		
+		if(!vector->isr)
+		{
+			//a real XMEGA would jump to the bad interrupt vector and reset
+			fprintf(stderr, "sim: %s enabled without an ISR\n", vector->name);
+			exit(1);
+		}
+		
+		cli();
+		vector->isr();
+		sei();
+	}
+	
+	return handled;
+}
+
+static void sim_finish()
+{
+	if(simLatencyMode)
+	{
+		printf("stimulus_us,command_us,pwm_us\n");
+		
+		for(uint16_t i = 0; i < simNumStimuli; i++)
+		{
+			printf("%llu,%lld,%lld\n", (unsigned long long)simLatency[i].stimulus_us,
+					(long long)simLatency[i].command_us, (long long)simLatency[i].pwm_us);
+		}
+	}
+	
+	fprintf(stderr, "simulated %.3fs, %lu actuator changes, final state %u\n",
+			(double)simCycles / SIM_CPU_HZ, (unsigned long)simActuatorChanges, state);
+	fprintf(stderr, "ISR                  calls\n");
+	
+	for(uint8_t v = 0; v < NUM_VECTORS; v++)
+	{
+		if(simVectors[v].count) fprintf(stderr, "%-20s %lu\n", simVectors[v].name, (unsigned long)simVectors[v].count);
+	}
+	
+	exit(0);
+}
+
+//moves every peripheral on by one step and handles the interrupts it raised, returns how many ISRs ran
+static uint32_t sim_step()
+{
+	if(DMA.CTRL & DMA_RESET_bm)
+	{
+		memset((void *)&DMA, 0, sizeof(DMA));
+		memset(simDma, 0, sizeof(simDma));
+	}
+	
+	simCycles += SIM_STEP_CYCLES;
+	
+	sim_wheel_step();
+	
+	for(uint8_t t = 0; t < NUM_SIM_TIMERS; t++) sim_timer_step(&simTimers[t]);
+	
+	sim_adc_step();
+	sim_usart_step();
+	sim_button_step();
+	
+	uint32_t handled = sim_dispatch();
+	
+	sim_trace_actuators();
+	sim_latency_step();
+	
+	if(simCycles >= simEndCycles) sim_finish();
+	
+	return handled;
+}
+
+//////////	called by the firmware through the host headers
+
+uint64_t sim_time_us()
+{
+	return simCycles / (SIM_CPU_HZ / 1000000);
+}
+
+//sleep_cpu(), runs until at least one interrupt has been handled
+void sim_sleep()
+{
+	sim_trace_actuators();
+	
+	while(!sim_step());
+}
+
+//called while the firmware polls a register, see HAL_BUSY_WAIT in hal.h
+void sim_busy_wait()
+{
+	sim_step();
+}
+
+void sim_delay_us(double us)
+{
+	uint64_t end = simCycles + (uint64_t)(us * (SIM_CPU_HZ / 1000000));
+	
+	while(simCycles < end) sim_step();
+}
+
+//libAVRX_Clocks.a replacements, the simulated clock is always 32MHz
+void SetSystemClock(uint8_t clk_src, uint8_t prescaler_a, uint8_t prescaler_bc)
+{
+}
+
+void GetSystemClocks(volatile unsigned long *sys_clk, volatile unsigned long *per_clk)
+{
+	*sys_clk = SIM_CPU_HZ;
+	*per_clk = SIM_CPU_HZ;
+}
+
+int main(int argc, char **argv)
+{
+	const char *scenario = 0;
+	double offset_us = 0;
+	
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "-t") && i + 1 < argc) simEndCycles = (uint64_t)(atof(argv[++i]) * (SIM_CPU_HZ / 1000));
+		else if(!strcmp(argv[i], "-s") && i + 1 < argc) scenario = argv[++i];
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc) offset_us = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-q")) simTrace = 0;
+		else if(!strcmp(argv[i], "-l")) simLatencyMode = 1;
+		else if(!strcmp(argv[i], "-T") && i + 1 < argc)
+		{
+			i++;
+			simUsartOut = strcmp(argv[i], "-") ? fopen(argv[i], "wb") : stdout;
+			if(!simUsartOut)
+			{
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-t ms] [-s scenario] [-o us] [-q] [-l] [-T file]\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	if(scenario) sim_load_scenario(scenario);
+	else sim_default_scenario();
+	
+	for(uint16_t i = 0; i < simNumKeys; i++)
+	{
+		if(simKeys[i].time_us) simKeys[i].time_us += (uint64_t)offset_us;
+	}
+	
+	if(simLatencyMode) simTrace = 0;
+	
+	//power on reset
+	RST.STATUS = RST_PORF_bm;
+	
+	if(simTrace) printf("time_us,state,phase,lf,lr,rr,rf\n");
+	
+	firmware_main();
+	
+	return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * sim.h
+ *
+ * Created: 10/17/2026 6:40:15 PM
+ *  Author: Clint
+ */
+
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+
+//the virtual clock counts CPU cycles at 32MHz and the peripherals are stepped SIM_STEP_CYCLES at a time (1us)
+#define SIM_CPU_HZ 32000000UL
+#define SIM_STEP_CYCLES 32
+
+//time from an ADC conversion starting to its result being ready, per channel in a sweep
+#define SIM_ADC_CONVERSION_CYCLES 112
+
+//pack voltage to ADCA counts, the same divider and offset as battery.h
+#define SIM_BATTERY_MV_FULL_SCALE 10000
+#define SIM_BATTERY_ADC_OFFSET 200
+
+//wheel model used to drive the quadrature decoders, encoder counts per second at full duty on a SIM_WHEEL_NOMINAL_MV
+//pack (240 counts per 40ms ramp period), and the time constant the wheels take to reach a new speed
+#define SIM_WHEEL_COUNTS_PER_S 6000.0
+#define SIM_WHEEL_NOMINAL_MV 8200.0
+#define SIM_WHEEL_TAU_S 0.1
+
+//how long a simulated button is held down
+#define SIM_BUTTON_US 50000
+
+//most keyframes in a scenario
+#define SIM_MAX_KEYFRAMES 256
+
+#define SIM_KEY_SENSORS 0
+#define SIM_KEY_BATTERY 1
+#define SIM_KEY_BUTTON 2
+#define SIM_KEY_STIMULUS 3
+
+//one line of a scenario file, sensor and battery values are interpolated between keyframes of the same kind
+struct simKeyframe_t
+{
+	uint8_t kind;
+	uint64_t time_us;
+	uint16_t value[4];
+};
+
+uint64_t sim_time_us();
+void sim_sleep();
+void sim_busy_wait();
+void sim_delay_us(double us);
+
+
+#endif /* SIM_H_ */
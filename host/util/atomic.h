@@ -0,0 +1,35 @@
+/*
+ * atomic.h
+ *
+ * Created: 10/17/2026 6:34:05 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <util/atomic.h>, clears the simulated I bit for the block and puts it back after
+ */
+
+
+#ifndef HOST_UTIL_ATOMIC_H_
+#define HOST_UTIL_ATOMIC_H_
+
+#include <avr/interrupt.h>
+
+static inline uint8_t sim_atomic_enter()
+{
+	uint8_t sreg_i = sim_sreg_i;
+	
+	cli();
+	
+	return sreg_i;
+}
+
+static inline void sim_atomic_restore(const uint8_t *sreg_i)
+{
+	sim_sreg_i = *sreg_i;
+}
+
+#define ATOMIC_RESTORESTATE uint8_t sim_sreg_save __attribute__((cleanup(sim_atomic_restore))) = sim_atomic_enter()
+
+#define ATOMIC_BLOCK(type) for (type, sim_atomic_todo = 1; sim_atomic_todo; sim_atomic_todo = 0)
+
+
+#endif /* HOST_UTIL_ATOMIC_H_ */
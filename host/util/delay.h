@@ -0,0 +1,20 @@
+/*
+ * delay.h
+ *
+ * Created: 10/17/2026 6:34:52 PM
+ *  Author: Clint
+ *
+ *	Host build replacement for <util/delay.h>, a delay runs the simulated peripherals for that long
+ */
+
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+void sim_delay_us(double us);
+
+#define _delay_us(us) sim_delay_us(us)
+#define _delay_ms(ms) sim_delay_us((ms) * 1000.0)
+
+
+#endif /* HOST_UTIL_DELAY_H_ */
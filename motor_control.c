@@ -8,15 +8,42 @@
  */ 
 #include "motor_control.h"
 #include "gpio.h"
-#include "semaphores.h"
+#include "events.h"
+#include "power.h"
+#include "encoder.h"
+#include "restart.h"
+#include "profile.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
 struct motorControl_t;
-extern struct motorControl_t motorControl;
+extern volatile struct motorControl_t motorControl;
+
+//start profile for each motor, LF (CCA) and RR (CCC) are 1 from each H-bridge so they start first
+//and LR (CCB) and RF (CCD) start 1 ramp period later, overlapping as much as the inrush budget allows
+static struct motorStartProfile_t motorStart[NUM_MOTORS] =
+{
+	[MOTOR_LF] = {0, MIN_SPEED_LIMIT_TICKS, TICK_DELTA_MOTOR},
+	[MOTOR_LR] = {1, MIN_SPEED_LIMIT_TICKS, TICK_DELTA_MOTOR},
+	[MOTOR_RR] = {0, MIN_SPEED_LIMIT_TICKS, TICK_DELTA_MOTOR},
+	[MOTOR_RF] = {1, MIN_SPEED_LIMIT_TICKS, TICK_DELTA_MOTOR},
+};
+
+static volatile uint16_t motorInrushBudget = MOTOR_INRUSH_BUDGET_TICKS;
+
+//speed the escape code runs at, lowered or raised by the battery monitor (see battery.c)
+static volatile uint16_t motorTopSpeed = MOTOR_FAST_TICKS;
+
+static volatile struct motorStats_t motorStats;
+
+//largest total duty increase made in one ramp period, used to check the budget is being respected
+volatile uint16_t motorPeakInrush = 0;
+
+//spin timer length and ramp periods left until it next runs out, 0 when it is stopped
+static volatile uint16_t spinPeriods = 0;
+static uint16_t spinRemaining = 0;
 
-struct semaphore_t;
-extern struct semaphore_t semaphores;
 
 void initialize_motorControl()
 {
@@ -32,34 +59,58 @@ void initialize_motorControl()
 	
 	motorControl.direction = FORWARD;
 	
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		motorControl.current_ticks[ch] = 0;
+		motorControl.target_ticks[ch] = 0;
+		motorControl.start_wait[ch] = MOTOR_START_IDLE;
+	}
+	
+	motorControl.brake_periods = 0;
+	
+	reset_motor_stats();
+	
+	motorControl.pending_phase = BOT_FORWARD;
+	motorControl.direction_pending = 0;
+	motorControl.ramp_busy = 0;
+	
 	//set initial direction to forward for all motors
+	motorControl.phase = 0x0f;
 	PORTD_OUT = 0x0f;
-
+	
 }
 
-//Timer E0 is used to control the PWM for the motor speeds
+//Timer E0 is used to control the PWM for the motor speeds, see MOTOR_PWM_HF in motor_control.h for the modes
 void setup_E0_motorControl()
 {
 	//setup period for timer to 10000 ticks  (assuming 32MHz clock, this is 20ms with 64 prescaler)
-	TCE0_PER = MAX_TICKS_MOTOR;
-
-	//set prescaler for counter to 64 counts per 1 tick
-	TCE0_CTRLA = 0x05;
-
-	//enable CCA, CCB, CCC, CCD and use single slope waveform
-	TCE0_CTRLB = 0xF3;
-
+	//or 1599 ticks with no prescaler for 20kHz in high frequency mode
+	TCE0_PER = MOTOR_PWM_PER;
+	
+	//set prescaler for counter to 64 counts per 1 tick (1 in high frequency mode)
+	TCE0_CTRLA = MOTOR_PWM_CLKSEL;
+	
+	//enable CCA, CCB, CCC, CCD and use single slope waveform (or dual slope)
+	TCE0_CTRLB = 0xF0 | MOTOR_PWM_WGMODE;
+	
 	//set CCA, CCB, CCC, CCD to 0 ticks
 	TCE0_CCA = 0;
 	TCE0_CCB = 0;
 	TCE0_CCC = 0;
 	TCE0_CCD = 0;
-
+	
 	//turn on access to CCA, CCB, CCC, CCD compare output value
 	TCE0_CTRLC = 0x0F;
-
+	
 	//note that the signal for CCA is now on PE0, CCB on PE1, CCC on PE2, CCD on PE3
 	
+#if MOTOR_PWM_DEAD_TIME_TICKS
+	//insert dead time on all 4 channels, each channel now drives a complementary pair of pins on port E
+	AWEXE.DTBOTH = MOTOR_PWM_DEAD_TIME_TICKS;
+	AWEXE.OUTOVEN = 0xFF;
+	AWEXE.CTRL = AWEX_DTICCAEN_bm | AWEX_DTICCBEN_bm | AWEX_DTICCCEN_bm | AWEX_DTICCDEN_bm;
+#endif
+	
 }
 
 //Timer E1 is used when ramping up and down the motor speed to avoid drawing too much current and creating brown out.
@@ -67,276 +118,533 @@ void setup_E1_motorRamp()
 {
 	//setup period for timer to 20000 ticks  (assuming 32MHz clocks, this is 40ms with 64 prescale)
 	TCE1_PER = MAX_TICKS_RAMP;
-
+	
 	//set prescaler for counter to 64 counts per 1 tick
 	TCE1_CTRLA = 0x05;
-
+	
 	//set interrupt priority to low
 	TCE1_INTCTRLA = 0x01;	
 	
 }
 
-//unlock ramp semaphore when E1 overflows
-ISR(TCE1_OVF_vect)
+//returns the PORTD_OUT phase pattern used for the requested direction
+static uint8_t direction_to_phase(uint8_t direction)
 {
-	motorControl.ramp_semaphore = 1;
+	switch(direction)
+	{
+		case(LEFT):		return BOT_LEFT;
+		case(FORWARD):	return BOT_FORWARD;
+		case(BACKWARD):	return BOT_BACK;
+		case(RIGHT):	return BOT_RIGHT;
+		case(SPIN_CC):	return BOT_SPIN_CC;
+		case(SPIN_CCW):	return BOT_SPIN_CCW;
+	}
+	
+	return BOT_FORWARD;
 }
 
-void disable_all_CCx_E0()
+//PWM output layer, the only place the motor duty cycles are written. The new values go into the CCxBUF
+//buffer registers with the update locked, then the lock is released so all 4 are copied into CCA-CCD together
+//at the start of the next PWM period. This avoids runt pulses and keeps every motor on the same period
+//speeds are in MAX_TICKS_MOTOR ticks and are scaled to the E0 period here
+void pwm_write_E0(uint16_t lf, uint16_t lr, uint16_t rr, uint16_t rf)
 {
-	TCE0_CTRLB = 0x00;
+	TCE0_CTRLFSET = TC0_LUPD_bm;
+	
+	TCE0_CCABUF = MOTOR_PWM_TICKS(lf);
+	TCE0_CCBBUF = MOTOR_PWM_TICKS(lr);
+	TCE0_CCCBUF = MOTOR_PWM_TICKS(rr);
+	TCE0_CCDBUF = MOTOR_PWM_TICKS(rf);
+	
+	TCE0_CTRLFCLR = TC0_LUPD_bm;
 }
 
-void enable_all_CCx_E0()
+//sends motorControl.phase out with the duties just written to the buffers, at the PWM update that loads them
+static void pwm_phase_E0()
 {
-	TCE0_CTRLB = 0xF3;
+	if((motorControl.phase ^ PORTD_OUT) & MOTOR_PHASE_MASK) TCE0_INTCTRLA = TC_OVFINTLVL_LO_gc;
 }
 
-//used during debugging 
-void turn_off_all_motors()
+//copies the current speed of every motor into its PWM compare register. With MOTOR_CLOSED_LOOP the current ticks
+//are wheel speeds and the speed controllers in encoder.c work out the duty, otherwise they are the duty
+static void write_current_ticks_E0()
 {
-	while(motorControl.speed_ticks > MIN_SPEED_LIMIT_TICKS)
+	uint16_t duty[NUM_MOTORS];
+	
+	speed_control(motorControl.current_ticks, duty);
+	
+	pwm_write_E0(duty[MOTOR_LF], duty[MOTOR_LR], duty[MOTOR_RR], duty[MOTOR_RF]);
+	pwm_phase_E0();
+}
+
+//PWM update, E0 overflows at the start of every PWM period and loads CCxBUF into CCx. Only turned on by
+//pwm_phase_E0() while a new phase is waiting, it changes PORTD_OUT once its duties are in CCx and turns itself off
+ISR(TCE0_OVF_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_TCE0_OVF);
+	
+	//the reflex ISRs can brake, which changes the phase and the buffers, in the middle of this
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		if(motorControl.ramp_semaphore)
+		//the update is skipped while pwm_write_E0() has it locked, wait for the next one
+		if(!(TCE0_CTRLGSET & MOTOR_PWM_BV_bm))
 		{
-			motorControl.speed_ticks -= TICK_DELTA_MOTOR;
-			TCE0_CCA = motorControl.speed_ticks;
-			TCE0_CCB = motorControl.speed_ticks;
-			TCE0_CCC = motorControl.speed_ticks;
-			TCE0_CCD = motorControl.speed_ticks;
-			motorControl.ramp_semaphore = 0;
+			PORTD_OUT = motorControl.phase;
+			TCE0_INTCTRLA = 0;
+		}
+	}
+	
+	PROFILE_ISR_EXIT(PROFILE_TCE0_OVF);
+}
+
+//ramp engine, moves every motor one step closer to its target each time E1 overflows (40ms)
+ISR(TCE1_OVF_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_TCE1_OVF);
+	uint8_t busy = 0;
+	uint8_t flipping = 0;
+	uint8_t flipping_running = 0;
+	uint16_t budget = motorInrushBudget;
+	
+	motorStats.ramp_periods++;
+	if(motorControl.ramp_busy) motorStats.busy_periods++;
+	
+	//measure the wheel speeds every period, even while braking, so the odometry doesn't miss any movement
+	encoder_sample(PORTD_OUT);
+	
+	//spin timer, see set_spinTimer()
+	if(spinPeriods && !--spinRemaining)
+	{
+		spinRemaining = spinPeriods;
+		event_post(EVENT_QUEUE_LO, EVENT_SPIN_DONE, 0);
+	}
+	
+	//hold the brake burst until it has run for MOTOR_BRAKE_PERIODS
+	if(motorControl.brake_periods)
+	{
+		if(--motorControl.brake_periods)
+		{
+			PROFILE_ISR_EXIT(PROFILE_TCE1_OVF);
+			return;
 		}
 		
+		//the motors have stopped, put the phases back with every duty at 0 and leave them there for this period,
+		//so no bridge goes straight from the brake into a kick. The ramp carries on at the next overflow
+		motorControl.phase = motorControl.brake_phase;
+		RESTART_MARK_DIRTY();
+		write_current_ticks_E0();
+		PROFILE_ISR_EXIT(PROFILE_TCE1_OVF);
+		return;
 	}
-	//check to make sure we didn't go lower than the desired speed
-	if(motorControl.speed_ticks < MIN_SPEED_LIMIT_TICKS)
+	
+	//only the motors whose H-bridge phase changes have to stop for a direction change, the rest keep going
+	if(motorControl.direction_pending)
 	{
-		motorControl.speed_ticks = MIN_SPEED_LIMIT_TICKS;
-		TCE0_CCA = motorControl.speed_ticks;
-		TCE0_CCB = motorControl.speed_ticks;
-		TCE0_CCC = motorControl.speed_ticks;
-		TCE0_CCD = motorControl.speed_ticks;
+		flipping = (motorControl.phase ^ motorControl.pending_phase) & MOTOR_PHASE_MASK;
+		busy = 1;
 	}
 	
-	disable_all_CCx_E0();
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		uint16_t current = motorControl.current_ticks[ch];
+		uint16_t target = motorControl.target_ticks[ch];
+		uint16_t kick = motorStart[ch].kick_ticks;
+		
+		if(flipping & MOTOR_PHASE_bm(ch))
+		{
+			//ramp down to 0 before this motor's phase is flipped
+			current = (current > TICK_DELTA_MOTOR) ? current - TICK_DELTA_MOTOR : 0;
+			if(current) flipping_running = 1;
+		}
+		else if(current > target)
+		{
+			current = (current - target > TICK_DELTA_MOTOR) ? current - TICK_DELTA_MOTOR : target;
+		}
+		else if(current < target)
+		{
+			uint16_t step;
+			
+			if(current < kick && flipping)
+			{
+				//stopped motors start their offsets again once a flip holding others at 0 is done, otherwise the
+				//offsets run out during the flip and motors on the same H-bridge kick together after it
+				motorControl.start_wait[ch] = MOTOR_START_IDLE;
+				step = 0;
+			}
+			else if(current < kick)
+			{
+				//stopped motor, wait for its phase offset then kick to avoid drawing too much current at low speeds
+				if(motorControl.start_wait[ch] == MOTOR_START_IDLE) motorControl.start_wait[ch] = motorStart[ch].phase_offset;
+				
+				step = ((target < kick) ? target : kick) - current;
+				if(motorControl.start_wait[ch])
+				{
+					motorControl.start_wait[ch]--;
+					step = 0;
+				}
+			}
+			else
+			{
+				step = (target - current > motorStart[ch].slew_ticks) ? motorStart[ch].slew_ticks : target - current;
+			}
+			
+			//motors that don't fit in what is left of the inrush budget wait until the next period
+			if(step <= budget)
+			{
+				current += step;
+				budget -= step;
+			}
+		}
+		
+		if(current >= kick || current >= target) motorControl.start_wait[ch] = MOTOR_START_IDLE;
+		
+		motorControl.current_ticks[ch] = current;
+		if(current != target) busy = 1;
+	}
+	
+	if(motorInrushBudget - budget > motorPeakInrush) motorPeakInrush = motorInrushBudget - budget;
+	
+	//the motors being flipped are at 0 from this period, the new phase only goes out at the PWM update that loads
+	//the 0 into CCx so they are stopped when it changes. They ramp back up on the next overflow
+	if(motorControl.direction_pending && !flipping_running)
+	{
+		motorControl.phase = motorControl.pending_phase;
+		motorControl.direction_pending = 0;
+		RESTART_MARK_DIRTY();
+	}
+	
+	write_current_ticks_E0();
+	motorControl.speed_ticks = motorControl.current_ticks[MOTOR_LF];
+	
+	if(motorControl.ramp_busy && !busy) event_post(EVENT_QUEUE_LO, EVENT_RAMP_DONE, 0);
+	motorControl.ramp_busy = busy;
+	PROFILE_ISR_EXIT(PROFILE_TCE1_OVF);
 }
 
-void turn_on_all_motors(uint16_t desiredSpeed)
+void disable_all_CCx_E0()
 {
-	enable_all_CCx_E0();
+	TCE0_CTRLB = 0x00;
+}
+
+void enable_all_CCx_E0()
+{
+	TCE0_CTRLB = 0xF0 | MOTOR_PWM_WGMODE;
+}
+
+//sets the speed every motor should ramp to, returns immediately and the E1 overflow ISR does the ramping
+void motor_set_target(uint16_t desired_speed)
+{
+	if(desired_speed) restart_first_move();
 	
-	while(motorControl.speed_ticks < desiredSpeed)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		if(motorControl.ramp_semaphore)
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
 		{
-			motorControl.speed_ticks += TICK_DELTA_MOTOR;
-			TCE0_CCA = motorControl.speed_ticks;
-			TCE0_CCB = motorControl.speed_ticks;
-			TCE0_CCC = motorControl.speed_ticks;
-			TCE0_CCD = motorControl.speed_ticks;
-			motorControl.ramp_semaphore = 0;
+			motorControl.target_ticks[ch] = desired_speed;
+			if(motorControl.current_ticks[ch] != desired_speed) motorControl.ramp_busy = 1;
 		}
 		
+		RESTART_MARK_DIRTY();
 	}
-	//check to make sure we didn't go past the limit
-	if(motorControl.speed_ticks > desiredSpeed)
+}
+
+//sets up the phase change for a new direction, must be called with interrupts off
+static void set_direction_phase(uint8_t direction, uint8_t phase)
+{
+	if((uint8_t)motorControl.direction != direction) motorStats.direction_changes++;
+	motorControl.direction = direction;
+	RESTART_MARK_DIRTY();
+	
+	//no need to stop if the H-bridges are already set up for this direction (the phases are flipped during a brake)
+	uint8_t current_phase = motorControl.brake_periods ? motorControl.brake_phase : motorControl.phase;
+	if(motorControl.direction_pending || current_phase != phase)
 	{
-		motorControl.speed_ticks = desiredSpeed;
-		TCE0_CCA = motorControl.speed_ticks;
-		TCE0_CCB = motorControl.speed_ticks;
-		TCE0_CCC = motorControl.speed_ticks;
-		TCE0_CCD = motorControl.speed_ticks;
+		motorControl.pending_phase = phase;
+		motorControl.direction_pending = 1;
+		motorControl.ramp_busy = 1;
 	}
-	
 }
 
+//requests a new direction, returns immediately. The E1 overflow ISR ramps down only the motors whose phase
+//changes, flips their phase once they are at 0 and then ramps them back up to their targets. The other motors stay at speed
+void motor_set_direction(uint8_t direction)
+{
+	uint8_t phase = direction_to_phase(direction);
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		set_direction_phase(direction, phase);
+	}
+}
 
-void set_direction(uint8_t direction)
+//mecanum wheel mixer, vx is forwards, vy is to the left and w is counter clockwise seen from above, in any units.
+//The wheel speeds are scaled so the fastest wheel runs at speed ticks and the phases are set from their signs,
+//this covers the 6 BOT_ patterns (e.g. vy alone gives BOT_LEFT) as well as diagonals and curves
+void motor_mix(int16_t vx, int16_t vy, int16_t w, uint16_t speed)
 {
-	//save the current speed
-	motorControl.target_speed_ticks = motorControl.speed_ticks;
+	int32_t wheel[NUM_MOTORS];
+	uint32_t fastest = 0;
+	uint16_t ticks[NUM_MOTORS];
+	uint8_t phase = 0;
+	uint8_t stopped = 0;
+	uint8_t direction;
 	
-	//ramp down to 0
-	set_speed_with_ramp(0);
+	wheel[MOTOR_LF] = (int32_t)vx - vy - w;
+	wheel[MOTOR_LR] = (int32_t)vx + vy - w;
+	wheel[MOTOR_RR] = (int32_t)vx - vy + w;
+	wheel[MOTOR_RF] = (int32_t)vx + vy + w;
 	
-	//set the new direction
-	switch(direction)
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
 	{
-		case(LEFT):	
-			PORTD_OUT = BOT_LEFT;
-			motorControl.direction = LEFT;
-		
-			break;
-		case(FORWARD):
-			PORTD_OUT = BOT_FORWARD;
-			motorControl.direction = FORWARD;
-		
-			break;
-		case(BACKWARD):
-			PORTD_OUT = BOT_BACK;
-			motorControl.direction = BACKWARD;
-		
-			break;
-		case(RIGHT):
-			PORTD_OUT = BOT_RIGHT;
-			motorControl.direction = RIGHT;
-		
-			break;
-		
-		case(SPIN_CC):
-			PORTD_OUT = BOT_SPIN_CC;
-			motorControl.direction = SPIN_CC;
-			
-			break;
+		uint32_t magnitude = (wheel[ch] < 0) ? -wheel[ch] : wheel[ch];
+		if(magnitude > fastest) fastest = magnitude;
+	}
+	
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		uint32_t magnitude = (wheel[ch] < 0) ? -wheel[ch] : wheel[ch];
 		
-		case(SPIN_CCW):
-			PORTD_OUT = BOT_SPIN_CCW;
-			motorControl.direction = SPIN_CCW;
+		ticks[ch] = fastest ? (uint16_t)(magnitude * speed / fastest) : 0;
 		
-			break;
-			
+		if(ticks[ch] < MOTOR_MIX_DEADBAND)
+		{
+			ticks[ch] = 0;
+			stopped |= MOTOR_PHASE_bm(ch);
+		}
+		else if(wheel[ch] > 0)
+		{
+			phase |= MOTOR_PHASE_bm(ch);
+		}
 	}
 	
-	//ramp back up to previous speed
-	set_speed_with_ramp(motorControl.target_speed_ticks);
+	//record the named direction closest to the motion, keeping the current one when it is just as close
+	int16_t ax = (vx < 0) ? -vx : vx;
+	int16_t ay = (vy < 0) ? -vy : vy;
+	uint8_t along_x = (vx < 0) ? BACKWARD : FORWARD;
+	uint8_t along_y = (vy < 0) ? RIGHT : LEFT;
+	
+	if(!ax && !ay) direction = (w < 0) ? SPIN_CC : SPIN_CCW;
+	else if(ax > ay) direction = along_x;
+	else if(ay > ax) direction = along_y;
+	else direction = ((uint8_t)motorControl.direction == along_y) ? along_y : along_x;
+	
+	if(speed) restart_first_move();
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		//stopped wheels keep whatever phase they have or are about to get
+		uint8_t current_phase = motorControl.direction_pending ? motorControl.pending_phase :
+								motorControl.brake_periods ? motorControl.brake_phase : motorControl.phase;
 		
+		set_direction_phase(direction, phase | (current_phase & stopped));
+		
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+		{
+			motorControl.target_ticks[ch] = ticks[ch];
+			if(motorControl.current_ticks[ch] != ticks[ch]) motorControl.ramp_busy = 1;
+		}
+	}
 }
 
+//changes how a motor starts, phase_offset is in ramp periods (40ms) and kick_ticks and slew_ticks in MAX_TICKS_MOTOR ticks
+void motor_set_start_profile(uint8_t ch, uint8_t phase_offset, uint16_t kick_ticks, uint16_t slew_ticks)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		motorStart[ch].phase_offset = phase_offset;
+		motorStart[ch].kick_ticks = kick_ticks;
+		motorStart[ch].slew_ticks = slew_ticks;
+	}
+}
 
-void set_speed_with_ramp(uint16_t desired_speed)
+//changes the kick and slew of every motor at once, the phase offsets are kept
+void motor_set_start_levels(uint16_t kick_ticks, uint16_t slew_ticks)
 {
-	//ramp down
-	if(desired_speed < motorControl.speed_ticks)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		while(motorControl.speed_ticks > desired_speed)
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
 		{
-			if(motorControl.ramp_semaphore)
-			{
-				motorControl.speed_ticks -= TICK_DELTA_MOTOR;
-				TCE0_CCA = motorControl.speed_ticks;
-				TCE0_CCB = motorControl.speed_ticks;
-				TCE0_CCC = motorControl.speed_ticks;
-				TCE0_CCD = motorControl.speed_ticks;
-				motorControl.ramp_semaphore = 0;
-			}
-			
+			motorStart[ch].kick_ticks = kick_ticks;
+			motorStart[ch].slew_ticks = slew_ticks;
 		}
-		//check to make sure we aren't going to go negative
-		if(motorControl.speed_ticks < TICK_DELTA_MOTOR)
-		{
-			motorControl.speed_ticks = 0;
-			TCE0_CCA = motorControl.speed_ticks;
-			TCE0_CCB = motorControl.speed_ticks;
-			TCE0_CCC = motorControl.speed_ticks;
-			TCE0_CCD = motorControl.speed_ticks;
-		}
-		
 	}
+}
+
+//changes the speed returned by motor_top_speed(), running motors keep their target until they are next told to move
+void motor_set_top_speed(uint16_t ticks)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		motorTopSpeed = ticks;
+	}
+}
+
+//fastest speed the pack can run the motors at, MOTOR_FAST_TICKS unless the battery monitor has changed it
+uint16_t motor_top_speed()
+{
+	uint16_t ticks;
 	
-	//ramp up but do 2 motors at a time, 1 from each H-bridge
-	else
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		uint16_t speedHolder = motorControl.speed_ticks;
+		ticks = motorTopSpeed;
+	}
+	
+	return ticks;
+}
+
+//changes the most the motors can increase their duty in total every ramp period
+void motor_set_inrush_budget(uint16_t budget_ticks)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		motorInrushBudget = budget_ticks;
+	}
+}
+
+//stops the robot much faster than ramping down, the motors that are running are reversed with a short duty
+//burst which is ended by the ramp ISR. All targets are set to 0, new targets ramp up once the brake is done
+void motor_brake()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t running = 0;
 		
-		//ramp up LF (CCA) and RR (CCC) first
-		while(motorControl.speed_ticks < desired_speed)
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
 		{
-			//ramp up to 70% before starting motor to avoid drawing too much current at low speeds
-			if(motorControl.speed_ticks < MIN_SPEED_LIMIT_TICKS)
-			{
-				motorControl.speed_ticks = MIN_SPEED_LIMIT_TICKS;
-				TCE0_CCA = motorControl.speed_ticks;
-				TCE0_CCC = motorControl.speed_ticks;
-			}
-			
-			else if(motorControl.ramp_semaphore)
-			{
-				motorControl.speed_ticks += TICK_DELTA_MOTOR;
-				TCE0_CCA = motorControl.speed_ticks;
-				TCE0_CCC = motorControl.speed_ticks;
-				motorControl.ramp_semaphore = 0;
-			}
+			if(motorControl.current_ticks[ch]) running |= MOTOR_PHASE_bm(ch);
 			
+			motorControl.current_ticks[ch] = 0;
+			motorControl.target_ticks[ch] = 0;
+			motorControl.start_wait[ch] = MOTOR_START_IDLE;
 		}
-		//check to make sure we didn't go past the limit
-		if(motorControl.speed_ticks > desired_speed)
-		{
-			motorControl.speed_ticks = desired_speed;
-			TCE0_CCA = motorControl.speed_ticks;
-			TCE0_CCC = motorControl.speed_ticks;
-		}		
-		
-		//reset motorControl
-		motorControl.speed_ticks = speedHolder;
 		
-		//ramp up RF (CCD) and LR (CCB) second
-		while(motorControl.speed_ticks < desired_speed)
+		//nothing to do if the motors are already stopped or braking
+		if(running && !motorControl.brake_periods)
 		{
-			//ramp up to 70% before starting motor to avoid drawing too much current
-			if(motorControl.speed_ticks < MIN_SPEED_LIMIT_TICKS)
-			{
-				motorControl.speed_ticks = MIN_SPEED_LIMIT_TICKS;
-				TCE0_CCB = motorControl.speed_ticks;
-				TCE0_CCD = motorControl.speed_ticks;
-			}
+			//flip the phase of the running motors so they are driven against their rotation. The reversed phase
+			//goes out at the same PWM update as the brake duty, never with the duty they were running at
+			motorControl.brake_phase = motorControl.phase;
+			motorControl.phase ^= running;
 			
-			else if(motorControl.ramp_semaphore)
-			{
-				motorControl.speed_ticks += TICK_DELTA_MOTOR;
-				TCE0_CCB = motorControl.speed_ticks;
-				TCE0_CCD = motorControl.speed_ticks;
-				motorControl.ramp_semaphore = 0;
-			}
+			pwm_write_E0((running & MOTOR_PHASE_bm(MOTOR_LF)) ? MOTOR_BRAKE_TICKS : 0,
+						 (running & MOTOR_PHASE_bm(MOTOR_LR)) ? MOTOR_BRAKE_TICKS : 0,
+						 (running & MOTOR_PHASE_bm(MOTOR_RR)) ? MOTOR_BRAKE_TICKS : 0,
+						 (running & MOTOR_PHASE_bm(MOTOR_RF)) ? MOTOR_BRAKE_TICKS : 0);
+			pwm_phase_E0();
 			
+			//the burst is ended by an E1 overflow, which isn't moved since the ramp and the spin timer count its periods.
+			//With less than half of this period left it is held for one more, so it lasts MOTOR_BRAKE_PERIODS on average
+			motorControl.brake_periods = MOTOR_BRAKE_PERIODS + (TCE1_CNT > MAX_TICKS_RAMP / 2);
+			motorControl.speed_ticks = 0;
+			motorControl.ramp_busy = 1;
+			
+			//start the speed controllers from scratch once the brake is done
+			speed_control_reset();
 		}
 		
-		//check to make sure we didn't go past the limit
-		if(motorControl.speed_ticks > desired_speed)
-		{
-			motorControl.speed_ticks = desired_speed;
-			TCE0_CCB = motorControl.speed_ticks;
-			TCE0_CCD = motorControl.speed_ticks;
-		}
-		
+		RESTART_MARK_DIRTY();
 	}
-	
 }
 
+void reset_motor_stats()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		motorStats.direction_changes = 0;
+		motorStats.ramp_periods = 0;
+		motorStats.busy_periods = 0;
+	}
+}
 
-//This should only be used during debugging while observing PWM with O-Scope, it will cause brown out because
-//The batteries/H-Bridge cannot supply enough current to start all motors at the same time. 
-void set_speed_no_ramp(uint16_t desired_speed)
+//direction changes per minute since the stats were reset, there are 1500 ramp periods in a minute
+uint16_t get_direction_changes_per_min()
+{
+	uint32_t changes, periods;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		changes = motorStats.direction_changes;
+		periods = motorStats.ramp_periods;
+	}
+	
+	if(!periods) return 0;
+	
+	return (uint16_t)(changes * 1500 / periods);
+}
+
+//time spent ramping (or braking) in 1/1000s of the time since the stats were reset
+uint16_t get_ramp_loss_permille()
 {
-	TCE0_CCA = desired_speed;
-	TCE0_CCB = desired_speed;
-	TCE0_CCC = desired_speed;
-	TCE0_CCD = desired_speed;
+	uint32_t busy, periods;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		busy = motorStats.busy_periods;
+		periods = motorStats.ramp_periods;
+	}
+	
+	if(!periods) return 0;
 	
+	return (uint16_t)(busy * 1000 / periods);
 }
 
+//returns 1 when every motor has reached its target speed and no direction change is in progress
+uint8_t motor_ramp_done()
+{
+	return !motorControl.ramp_busy;
+}
 
-//spin timer is used to determine how long robot should spin while in spinning state
-void setup_C1_spinTimer()
+//used during debugging 
+void turn_off_all_motors()
 {
-	//setup period for timer to 0, but it will be 62500 ticks when used (assuming 32MHz clocks, this is 2s with 1024 prescale)
-	TCC1_PER = 0;
+	set_speed_with_ramp(MIN_SPEED_LIMIT_TICKS);
+	
+	disable_all_CCx_E0();
+}
 
-	//set prescaler for counter to 1024 counts per 1 tick
-	TCC1_CTRLA = 0x07;
+void turn_on_all_motors(uint16_t desiredSpeed)
+{
+	enable_all_CCx_E0();
+	
+	set_speed_with_ramp(desiredSpeed);
+}
 
-	//set interrupt priority to low
-	TCC1_INTCTRLA = 0x01;
+
+//blocking version of motor_set_direction(), waits until the motors are back up to speed in the new direction
+void set_direction(uint8_t direction)
+{
+	motor_set_direction(direction);
 	
+	while(!motor_ramp_done()) SLEEP_UNLESS(motor_ramp_done());
 }
 
-//called when spin timer overflows
-ISR(TCC1_OVF_vect)
+
+//blocking version of motor_set_target(), waits until every motor has reached the desired speed
+void set_speed_with_ramp(uint16_t desired_speed)
 {
-	semaphores.spin_complete = 1;	
+	motor_set_target(desired_speed);
+	
+	while(!motor_ramp_done()) SLEEP_UNLESS(motor_ramp_done());
 }
 
-void set_spinTimer(uint16_t ticks)
+
+//This should only be used during debugging while observing PWM with O-Scope, it will cause brown out because
+//The batteries/H-Bridge cannot supply enough current to start all motors at the same time. 
+void set_speed_no_ramp(uint16_t desired_speed)
 {
-	TCC1_PER = ticks;
+	pwm_write_E0(desired_speed, desired_speed, desired_speed, desired_speed);
+	
 }
 
+
+//spin timer is used to determine how long robot should spin while in spinning state. It counts E1 ramp periods (40ms)
+//so it doesn't need a timer of its own, C1 decodes a wheel encoder instead (see encoder.c)
+//starts the spin timer with the number of ramp periods passed, 0 stops it
+void set_spinTimer(uint16_t periods)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		spinPeriods = periods;
+		spinRemaining = periods;
+	}
+}
@@ -16,7 +16,82 @@
 #define MIN_SPEED_LIMIT_TICKS 8000
 #define TICK_DELTA_MOTOR 500
 #define MAX_TICKS_RAMP 20000
-#define SPIN_TICKS 62500
+
+//how long the robot spins for when trapped, in ramp periods (50 is 2s)
+#define SPIN_PERIODS 50
+
+//motor PWM mode. 0 is the original 50Hz PWM (MAX_TICKS_MOTOR ticks at prescale 64), 1 runs E0 at
+//MOTOR_PWM_FREQ_HZ with no prescaler. Speeds are always given in MAX_TICKS_MOTOR ticks and are scaled to
+//the high frequency period by pwm_write_E0(), so MOTOR_*_TICKS keep the same duty cycle in both modes
+#ifndef MOTOR_PWM_HF
+#define MOTOR_PWM_HF 0
+#endif
+
+#define MOTOR_PWM_CLK_HZ 32000000UL
+#define MOTOR_PWM_FREQ_HZ 20000UL
+
+//1 uses dual slope (centre aligned) PWM in high frequency mode, 0 uses single slope
+#define MOTOR_PWM_DUAL_SLOPE 0
+
+//dead time inserted by AWeX E between the low and high side outputs of each channel, in 31.25ns clock
+//ticks, 0 turns AWeX off. Only use this when the bridge is driven with complementary signals: with dead time
+//on, CCA drives PE0 (low side) and PE1 (high side), CCB drives PE2/PE3, CCC PE4/PE5 and CCD PE6/PE7
+#define MOTOR_PWM_DEAD_TIME_TICKS 0
+
+#if MOTOR_PWM_HF
+#if MOTOR_PWM_DUAL_SLOPE
+#define MOTOR_PWM_PER (MOTOR_PWM_CLK_HZ / (2 * MOTOR_PWM_FREQ_HZ))
+#define MOTOR_PWM_WGMODE TC_WGMODE_DS_B_gc
+#else
+#define MOTOR_PWM_PER (MOTOR_PWM_CLK_HZ / MOTOR_PWM_FREQ_HZ - 1)
+#define MOTOR_PWM_WGMODE TC_WGMODE_SS_gc
+#endif
+#define MOTOR_PWM_CLKSEL TC_CLKSEL_DIV1_gc
+
+//MAX_TICKS_MOTOR ticks to E0 ticks as a 16 bit fraction so scaling is a multiply and a shift
+#define MOTOR_PWM_SCALE_Q16 ((MOTOR_PWM_PER << 16) / MAX_TICKS_MOTOR)
+#define MOTOR_PWM_TICKS(ticks) ((uint16_t)(((uint32_t)(ticks) * MOTOR_PWM_SCALE_Q16) >> 16))
+#else
+#define MOTOR_PWM_PER MAX_TICKS_MOTOR
+#define MOTOR_PWM_WGMODE TC_WGMODE_SS_gc
+#define MOTOR_PWM_CLKSEL TC_CLKSEL_DIV64_gc
+#define MOTOR_PWM_TICKS(ticks) (ticks)
+#endif
+
+//CCxBUF has been written but not yet loaded into CCx
+#define MOTOR_PWM_BV_bm (TC0_CCABV_bm | TC0_CCBBV_bm | TC0_CCCBV_bm | TC0_CCDBV_bm)
+
+//start scheduler defaults. A stopped motor waits its phase offset (in ramp periods) after being told to start,
+//then kicks straight to its kick level and slews up from there. Every ramp period the motors can only increase
+//their duty by MOTOR_INRUSH_BUDGET_TICKS in total, motors that don't fit in the budget wait for the next period.
+//The default budget lets 2 motors kick at once, which is what the batteries/H-bridges can start without brown out
+#define MOTOR_INRUSH_BUDGET_TICKS 16000
+#define MOTOR_START_IDLE 0xFF
+
+//active brake, the running motors are driven against their rotation at MOTOR_BRAKE_TICKS for about
+//MOTOR_BRAKE_PERIODS ramp periods (40ms each), then held at 0 duty with their phases put back for one more
+//period before anything is kicked. Kept below full duty
+//because reversing a spinning motor draws close to twice its stall current
+#define MOTOR_BRAKE_TICKS 5000
+#define MOTOR_BRAKE_PERIODS 1
+
+struct motorStats_t
+{
+	//actual direction changes made by motor_set_direction()
+	uint16_t direction_changes;
+	
+	//E1 overflows (40ms each) since the stats were reset and how many of them had a ramp in progress
+	uint32_t ramp_periods;
+	uint32_t busy_periods;
+	
+};
+
+struct motorStartProfile_t
+{
+	uint8_t phase_offset;
+	uint16_t kick_ticks;
+	uint16_t slew_ticks;
+};
 
 #define MOTOR_SLOW_TICKS 2000
 #define MOTOR_MEDIUM_TICKS 5000
@@ -41,6 +116,20 @@
 #define BOT_SPIN_CC 0x03
 #define BOT_SPIN_CCW 0x0C
 
+//wheels the mixer would run slower than this are stopped instead, they keep their phase so they don't cause a direction change
+#define MOTOR_MIX_DEADBAND 1000
+
+//motor channels, index matches the TCE0 compare channel (CCA, CCB, CCC, CCD) driving each motor
+#define NUM_MOTORS 4
+#define MOTOR_LF 0
+#define MOTOR_LR 1
+#define MOTOR_RR 2
+#define MOTOR_RF 3
+
+//PORTD bit n is the H-bridge phase input of the motor driven by TCE0 compare channel n
+#define MOTOR_PHASE_MASK 0x0F
+#define MOTOR_PHASE_bm(ch) (1 << (ch))
+
 struct motorControl_t
 {
 	int speed_ticks			:16;
@@ -56,7 +145,29 @@ struct motorControl_t
 	
 	int direction			:3;
 	
-	int ramp_semaphore		:1;
+	//ramp engine, only the TCE1 overflow ISR writes current_ticks and the PWM compare registers
+	//main sets target_ticks and pending_direction through motor_set_target() and motor_set_direction()
+	uint16_t current_ticks[NUM_MOTORS];
+	uint16_t target_ticks[NUM_MOTORS];
+	
+	//ramp periods each stopped motor still has to wait before kicking, MOTOR_START_IDLE when not starting
+	uint8_t start_wait[NUM_MOTORS];
+	
+	//PORTD_OUT value to apply once the motors whose phase changes have ramped down to 0,
+	//only valid while direction_pending is set
+	uint8_t pending_phase;
+	uint8_t direction_pending;
+	
+	//phase pattern that goes with the duties last written to the CCxBUF registers. The E0 overflow ISR copies
+	//it to PORTD_OUT once they have been loaded into CCx, so a phase never changes ahead of its duty
+	uint8_t phase;
+	
+	//set by the ramp ISR while any motor has not yet reached its target
+	uint8_t ramp_busy;
+	
+	//ramp periods left in an active brake and the PORTD_OUT value to put back when it is done
+	uint8_t brake_periods;
+	uint8_t brake_phase;
 	
 };
 
@@ -66,12 +177,25 @@ void setup_E1_motorRamp();
 void set_direction(uint8_t direction);
 void set_speed_with_ramp(uint16_t desired_speed);
 void set_speed_no_ramp(uint16_t desired_speed);
+void pwm_write_E0(uint16_t lf, uint16_t lr, uint16_t rr, uint16_t rf);
+void motor_set_target(uint16_t desired_speed);
+void motor_set_direction(uint8_t direction);
+uint8_t motor_ramp_done();
+void motor_set_start_profile(uint8_t ch, uint8_t phase_offset, uint16_t kick_ticks, uint16_t slew_ticks);
+void motor_set_start_levels(uint16_t kick_ticks, uint16_t slew_ticks);
+void motor_set_top_speed(uint16_t ticks);
+uint16_t motor_top_speed();
+void motor_set_inrush_budget(uint16_t budget_ticks);
+void motor_mix(int16_t vx, int16_t vy, int16_t w, uint16_t speed);
+void motor_brake();
+void reset_motor_stats();
+uint16_t get_direction_changes_per_min();
+uint16_t get_ramp_loss_permille();
 void disable_all_CCx_E0();
 void enable_all_CCx_E0();
 void turn_off_all_motors();
 void turn_on_all_motors(uint16_t desiredSpeed);
-void setup_C1_spinTimer();
-void set_spinTimer(uint16_t ticks);
+void set_spinTimer(uint16_t periods);
 
 
 
@@ -0,0 +1,124 @@
+/*
+ * power.c
+ *
+ * Created: 10/17/2026 9:12:21 AM
+ *  Author: Clint
+ *
+ *	Main sleeps in idle between events instead of busy polling for them. Timers, the ADC, the DMA and
+ *	the event system all keep running in idle, so any interrupt wakes the CPU back up to handle it.
+ *
+ *	With POWER_MEASUREMENT set, the time spent asleep is added up with the free running C0 event timer (500kHz)
+ *	so the awake duty cycle and the current saved can be read back with get_awake_permille() and get_current_saved_ua()
+ */ 
+
+#include "power.h"
+#include "events.h"
+#include "profile.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#if POWER_MEASUREMENT
+static volatile struct powerStats_t powerStats;
+#endif
+
+void setup_sleep()
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+//must be called with interrupts disabled, see SLEEP_UNLESS. Returns with interrupts enabled
+void idle_sleep()
+{
+#if POWER_MEASUREMENT
+	uint16_t start = event_timestamp();
+#endif
+	
+	PROFILE_IDLE_BEGIN();
+	
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	
+	PROFILE_IDLE_END();
+	
+#if POWER_MEASUREMENT
+	//TCE1 wakes the CPU at least every 40ms so a sleep never spans more than one TCC0 overflow
+	uint16_t slept = event_timestamp() - start;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		powerStats.sleep_ticks += slept;
+	}
+#endif
+}
+
+//counts C0 overflows so the total time can be measured, C0 itself is set up by setup_C0_eventTimer()
+void setup_power_measurement()
+{
+#if POWER_MEASUREMENT
+	reset_power_stats();
+	
+	//set interrupt priority to low
+	TCC0_INTCTRLA = 0x01;
+#endif
+}
+
+#if POWER_MEASUREMENT
+ISR(TCC0_OVF_vect)
+{
+	PROFILE_ISR_ENTER(PROFILE_TCC0_OVF);
+	powerStats.overflows++;
+	PROFILE_ISR_EXIT(PROFILE_TCC0_OVF);
+}
+#endif
+
+void reset_power_stats()
+{
+#if POWER_MEASUREMENT
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		powerStats.start_count = event_timestamp();
+		powerStats.overflows = 0;
+		powerStats.sleep_ticks = 0;
+	}
+#endif
+}
+
+//returns the fraction of time the CPU has been awake since the stats were reset, in 1/1000
+uint16_t get_awake_permille()
+{
+#if POWER_MEASUREMENT
+	uint32_t total;
+	uint32_t asleep;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		total = ((uint32_t)powerStats.overflows << 16) + event_timestamp() - powerStats.start_count;
+		asleep = powerStats.sleep_ticks;
+	}
+	
+	if (total == 0) return 1000;
+	
+	//scale down so the multiply by 1000 can't overflow
+	while (total > 0x3FFFFF)
+	{
+		total >>= 1;
+		asleep >>= 1;
+	}
+	
+	return (uint16_t)(((total - asleep) * 1000) / total);
+#else
+	return 1000;
+#endif
+}
+
+//returns the estimated average current saved by sleeping compared to staying awake, in uA
+uint16_t get_current_saved_ua()
+{
+	uint32_t asleep_permille = 1000 - get_awake_permille();
+	
+	return (uint16_t)(((MCU_ACTIVE_CURRENT_UA - MCU_IDLE_CURRENT_UA) * asleep_permille) / 1000);
+}
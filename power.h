@@ -0,0 +1,49 @@
+/*
+ * power.h
+ *
+ * Created: 10/17/2026 9:12:05 AM
+ *  Author: Clint
+ */ 
+
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+//set to 1 to measure how long the CPU is awake vs asleep, uses the free running C0 event timer
+#ifndef POWER_MEASUREMENT
+#define POWER_MEASUREMENT 0
+#endif
+
+//approximate ATxmega128A1 supply current at 32MHz and 3.0V, used to estimate the current saved by sleeping
+#define MCU_ACTIVE_CURRENT_UA 11000
+#define MCU_IDLE_CURRENT_UA 4500
+
+//sleeps in idle until the next interrupt unless the condition is already true. Interrupts are off while
+//the condition is checked and sei is directly followed by sleep, so an event posted in between can't be missed
+#define SLEEP_UNLESS(condition) do { cli(); if (!(condition)) idle_sleep(); sei(); } while (0)
+
+struct powerStats_t
+{
+	//TCC0 overflows since measurement started, each one is 65536 ticks (131ms)
+	uint16_t overflows;
+	
+	//TCC0 count when measurement started
+	uint16_t start_count;
+	
+	//TCC0 ticks spent asleep since measurement started (2us per tick)
+	uint32_t sleep_ticks;
+	
+};
+
+void setup_sleep();
+void idle_sleep();
+void setup_power_measurement();
+void reset_power_stats();
+uint16_t get_awake_permille();
+uint16_t get_current_saved_ua();
+
+
+#endif /* POWER_H_ */
@@ -0,0 +1,219 @@
+/*
+ * profile.c
+ *
+ * Created: 10/17/2026 8:06:30 PM
+ *  Author: Clint
+ *
+ *	ISR profiler, only built in with ISR_PROFILING. Each profiled ISR calls PROFILE_ISR_ENTER() first thing
+ *	and PROFILE_ISR_EXIT() before it returns, which read F1 counting CPU cycles. A medium level ISR can be
+ *	interrupted by a high level one, so the ISRs running are kept on a small stack and the time a nested ISR
+ *	takes is taken off the one it interrupted and recorded as how long that one was held up.
+ *
+ *	Main marks when it goes to sleep with PROFILE_IDLE_BEGIN(). The idle time ends as soon as the next ISR
+ *	starts, rather than when main wakes up after it, so the ISR that wakes the CPU isn't counted as idle. Idle
+ *	and total time are measured with the C0 event timer (2us) since a sleep can be longer than F1's 2ms wrap.
+ *
+ *	profile_dump() copies everything into profileReport with the CPU load worked out and starts over. It is
+ *	run by button 8 in the testing state.
+ */
+
+#include "profile.h"
+#include "events.h"
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#if ISR_PROFILING
+volatile struct profileReport_t profileReport;
+static volatile struct isrProfile_t isrProfile[NUM_PROFILED_ISRS];
+
+//the ISRs running, the F1 count when each one started and the cycles ISRs that interrupted it have taken
+static uint8_t profileDepth = 0;
+static uint8_t profileMaxDepth = 0;
+static uint16_t profileStart[PROFILE_MAX_DEPTH];
+static uint16_t profilePreempted[PROFILE_MAX_DEPTH];
+
+//time asleep and the total time since the last reset, in C0 ticks
+static uint8_t profileIdle = 0;
+static uint16_t profileIdleStart;
+static uint16_t profileIdleLoops;
+static uint32_t profileIdleTicks;
+static uint32_t profileWindowTicks;
+static uint16_t profileLastTimestamp;
+
+//adds the time since the last call to the window, must be called at least once per C0 wrap (131ms)
+static void profile_clock_update(uint16_t now)
+{
+	profileWindowTicks += (uint16_t)(now - profileLastTimestamp);
+	profileLastTimestamp = now;
+}
+
+static void profile_end_idle(uint16_t now)
+{
+	profileIdleTicks += (uint16_t)(now - profileIdleStart);
+	profileIdle = 0;
+}
+#endif
+
+//F1 counts CPU cycles (the peripheral clock isn't divided), wrapping every 2ms at 32MHz
+void setup_F1_profileTimer()
+{
+#if ISR_PROFILING
+	TCF1_CTRLA = 0;
+	TCF1_PER = 0xFFFF;
+	TCF1_CTRLA = TC_CLKSEL_DIV1_gc;
+	
+	profile_reset();
+#endif
+}
+
+void profile_reset()
+{
+#if ISR_PROFILING
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for(uint8_t id = 0; id < NUM_PROFILED_ISRS; id++)
+		{
+			isrProfile[id].calls = 0;
+			isrProfile[id].min_cycles = 0xFFFF;
+			isrProfile[id].max_cycles = 0;
+			isrProfile[id].total_cycles = 0;
+			isrProfile[id].max_preempted_cycles = 0;
+			isrProfile[id].max_depth = 0;
+			isrProfile[id].min_period = 0xFFFF;
+			isrProfile[id].max_period = 0;
+		}
+		
+		profileMaxDepth = 0;
+		profileIdleLoops = 0;
+		profileIdleTicks = 0;
+		profileWindowTicks = 0;
+		profileLastTimestamp = event_timestamp();
+		if(profileIdle) profileIdleStart = profileLastTimestamp;
+	}
+#endif
+}
+
+//copies the stats into profileReport and starts measuring again, called by main so it is never idle here
+void profile_dump()
+{
+#if ISR_PROFILING
+	uint32_t isr_cycles = 0;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		profile_clock_update(event_timestamp());
+		
+		for(uint8_t id = 0; id < NUM_PROFILED_ISRS; id++)
+		{
+			profileReport.isr[id] = isrProfile[id];
+			isr_cycles += isrProfile[id].total_cycles;
+		}
+		
+		profileReport.window_ticks = profileWindowTicks;
+		profileReport.idle_ticks = profileIdleTicks;
+		profileReport.idle_loops = profileIdleLoops;
+		profileReport.max_depth = profileMaxDepth;
+	}
+	
+	//a C0 tick is 64 CPU cycles, divide the window down first so nothing overflows on long windows
+	uint32_t permille_ticks = profileReport.window_ticks / 1000;
+	
+	if(permille_ticks)
+	{
+		profileReport.isr_load_permille = (uint16_t)((isr_cycles / 64) / permille_ticks);
+		profileReport.cpu_load_permille = (uint16_t)((profileReport.window_ticks - profileReport.idle_ticks) / permille_ticks);
+	}
+	
+	profile_reset();
+#endif
+}
+
+void profile_isr_enter(uint8_t id)
+{
+#if ISR_PROFILING
+	//a higher level ISR can start at any point, even during this
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = TCF1_CNT;
+		uint16_t timestamp = event_timestamp();
+		volatile struct isrProfile_t *profile = &isrProfile[id];
+		uint8_t depth = profileDepth;
+		
+		if(profileIdle) profile_end_idle(timestamp);
+		
+		if(depth < PROFILE_MAX_DEPTH)
+		{
+			profileStart[depth] = now;
+			profilePreempted[depth] = 0;
+		}
+		
+		profileDepth = ++depth;
+		if(depth > profile->max_depth) profile->max_depth = depth;
+		if(depth > profileMaxDepth) profileMaxDepth = depth;
+		
+		if(profile->calls)
+		{
+			uint16_t period = timestamp - profile->last_entry;
+			
+			if(period < profile->min_period) profile->min_period = period;
+			if(period > profile->max_period) profile->max_period = period;
+		}
+		
+		profile->last_entry = timestamp;
+	}
+#endif
+}
+
+void profile_isr_exit(uint8_t id)
+{
+#if ISR_PROFILING
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = TCF1_CNT;
+		volatile struct isrProfile_t *profile = &isrProfile[id];
+		//an ISR that was already running when the profiler was set up
+		if(!profileDepth) return;
+		
+		uint8_t depth = --profileDepth;
+		
+		if(depth >= PROFILE_MAX_DEPTH) return;
+		
+		uint16_t elapsed = now - profileStart[depth];
+		uint16_t preempted = profilePreempted[depth];
+		uint16_t cycles = elapsed - preempted;
+		
+		//the whole time this ISR ran held up the one it interrupted
+		if(depth) profilePreempted[depth - 1] += elapsed;
+		
+		profile->calls++;
+		profile->total_cycles += cycles;
+		if(cycles < profile->min_cycles) profile->min_cycles = cycles;
+		if(cycles > profile->max_cycles) profile->max_cycles = cycles;
+		if(preempted > profile->max_preempted_cycles) profile->max_preempted_cycles = preempted;
+	}
+#endif
+}
+
+//called by idle_sleep() with interrupts off just before the CPU sleeps
+void profile_idle_begin()
+{
+#if ISR_PROFILING
+	uint16_t now = event_timestamp();
+	
+	profile_clock_update(now);
+	profileIdleStart = now;
+	profileIdle = 1;
+	profileIdleLoops++;
+#endif
+}
+
+//called by idle_sleep() after waking, in case an ISR that isn't profiled woke the CPU
+void profile_idle_end()
+{
+#if ISR_PROFILING
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if(profileIdle) profile_end_idle(event_timestamp());
+	}
+#endif
+}
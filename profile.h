@@ -0,0 +1,115 @@
+/*
+ * profile.h
+ *
+ * Created: 10/17/2026 8:05:44 PM
+ *  Author: Clint
+ */
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <avr/io.h>
+#include "encoder.h"
+
+//set to 1 to measure how long every ISR takes, how much they hold each other up and how busy the CPU is.
+//With 0 the PROFILE_ macros are empty so the ISRs and the idle loop are exactly as they would be without them.
+//Every button is already used in the testing state, so with 1 button 8 there dumps the profile (see profile_dump())
+//instead of doing nothing, which is all it does there otherwise as it only switches to testing
+#ifndef ISR_PROFILING
+#define ISR_PROFILING 0
+#endif
+
+//ISRs are timed in CPU cycles by F1 running free at the CPU clock, which only decodes an encoder in closed loop
+#if ISR_PROFILING && MOTOR_CLOSED_LOOP
+#error "ISR_PROFILING uses TCF1, which decodes the LR wheel encoder when MOTOR_CLOSED_LOOP is set"
+#endif
+
+//one per profiled ISR, ISRs at different PMIC levels can interrupt each other up to PROFILE_MAX_DEPTH deep
+#define PROFILE_TCE1_OVF 0
+#define PROFILE_TCC0_OVF 1
+#define PROFILE_TCC0_CCA 2
+#define PROFILE_TCD0_OVF 3
+#define PROFILE_TCD0_CCA 4
+#define PROFILE_TCD0_CCB 5
+#define PROFILE_TCD0_CCC 6
+#define PROFILE_TCD0_CCD 7
+#define PROFILE_DMA_CH0 8
+#define PROFILE_DMA_CH1 9
+#define PROFILE_ADCB_CH0 10
+#define PROFILE_ADCB_CH1 11
+#define PROFILE_ADCB_CH2 12
+#define PROFILE_ADCB_CH3 13
+#define PROFILE_ADCA_CH0 14
+#define PROFILE_PORTJ_INT0 15
+#define PROFILE_TCE0_OVF 16
+
+#define NUM_PROFILED_ISRS 17
+#define PROFILE_MAX_DEPTH 3
+
+#if ISR_PROFILING
+#define PROFILE_ISR_ENTER(id) profile_isr_enter(id)
+#define PROFILE_ISR_EXIT(id) profile_isr_exit(id)
+#define PROFILE_IDLE_BEGIN() profile_idle_begin()
+#define PROFILE_IDLE_END() profile_idle_end()
+#else
+#define PROFILE_ISR_ENTER(id)
+#define PROFILE_ISR_EXIT(id)
+#define PROFILE_IDLE_BEGIN()
+#define PROFILE_IDLE_END()
+#endif
+
+struct isrProfile_t
+{
+	uint16_t calls;
+	
+	//CPU cycles from the start to the end of the ISR body, not counting any ISRs that interrupted it.
+	//The prologue and epilogue the compiler adds around the body aren't included
+	uint16_t min_cycles;
+	uint16_t max_cycles;
+	uint32_t total_cycles;
+	
+	//longest a single call was held up by higher level ISRs
+	uint16_t max_preempted_cycles;
+	
+	//deepest it has run, 1 when it has only ever interrupted main
+	uint8_t max_depth;
+	
+	//shortest and longest time between two calls in C0 ticks (2us), how much a periodic ISR jitters.
+	//Only right for ISRs that run at least every 131ms, longer periods wrap
+	uint16_t min_period;
+	uint16_t max_period;
+	uint16_t last_entry;
+	
+};
+
+//copy of the stats made by profile_dump(), read it with the debugger
+struct profileReport_t
+{
+	struct isrProfile_t isr[NUM_PROFILED_ISRS];
+	
+	//C0 ticks (2us) covered by the report and how many of them the CPU was asleep
+	uint32_t window_ticks;
+	uint32_t idle_ticks;
+	
+	//times main went to sleep
+	uint16_t idle_loops;
+	
+	//share of the CPU used by all ISRs and by everything (ISRs and main), in 1/1000
+	uint16_t isr_load_permille;
+	uint16_t cpu_load_permille;
+	
+	uint8_t max_depth;
+	
+};
+
+void setup_F1_profileTimer();
+void profile_reset();
+void profile_dump();
+void profile_isr_enter(uint8_t id);
+void profile_isr_exit(uint8_t id);
+void profile_idle_begin();
+void profile_idle_end();
+
+
+#endif /* PROFILE_H_ */
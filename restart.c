@@ -0,0 +1,201 @@
+/*
+ * restart.c
+ *
+ * Created: 10/17/2026 5:42:20 PM
+ *  Author: Clint
+ *
+ *	A brown out resets every peripheral but leaves the SRAM alone. Main saves a checksummed copy of the
+ *	robot's state in .noinit RAM after every batch of events that changes it (the reflex and ramp ISRs mark
+ *	their changes with RESTART_MARK_DIRTY()), so when RST.STATUS says the reset was a brown out and the copy
+ *	is good, the robot carries on with its filters full and its motors heading the same way instead of waiting
+ *	for new measurements. Power on and any bad copy take the normal cold start.
+ *
+ *	The motors are always restarted from 0 duty through the ramp and its inrush budget, since starting them
+ *	at their old duty all at once is what browns the robot out in the first place.
+ */
+
+#include "restart.h"
+#include "motor_control.h"
+#include "sensors.h"
+#include "events.h"
+#include <avr/io.h>
+#include <stddef.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+//global variables declared in escape_robot.c
+extern volatile uint16_t threat_distance[4];
+extern volatile uint8_t closestThreat;
+extern volatile uint8_t furthestThreat;
+extern volatile struct motorControl_t motorControl;
+extern volatile struct infrResults_t infrResults;
+extern struct threatTrack_t threatTrack;
+extern volatile uint8_t headingDwell;
+extern volatile uint8_t state;
+
+static struct warmState_t warmState __attribute__((section(".noinit")));
+static struct restartStats_t restartStats __attribute__((section(".noinit")));
+
+//C0 ticks since restart_begin() started C0, kept up to date by main (at least every sample period) so it doesn't miss a C0 wrap
+static uint32_t restartTicks = 0;
+static uint16_t restartLastTimestamp = 0;
+static uint8_t restartPath = RESTART_COLD;
+volatile uint8_t restartDirty = 0;
+static uint8_t restartMoved = 0;
+
+static void copy_bytes(volatile void *to, const volatile void *from, uint16_t size)
+{
+	volatile uint8_t *dest = (volatile uint8_t *)to;
+	const volatile uint8_t *src = (const volatile uint8_t *)from;
+	
+	while(size--) *dest++ = *src++;
+}
+
+//CRC-CCITT of everything in the saved state before the checksum itself
+static uint16_t warm_state_crc()
+{
+	const uint8_t *data = (const uint8_t *)&warmState;
+	uint16_t crc = 0xFFFF;
+	
+	for(uint16_t i = 0; i < offsetof(struct warmState_t, crc); i++) crc = _crc_ccitt_update(crc, data[i]);
+	
+	return crc;
+}
+
+static void restart_clock_update()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = event_timestamp();
+		
+		restartTicks += (uint16_t)(now - restartLastTimestamp);
+		restartLastTimestamp = now;
+	}
+}
+
+//starts C0, reads and clears the reset cause and returns RESTART_WARM if the saved state can be restored.
+//Must be called first thing in main, before the clock is switched
+uint8_t restart_begin()
+{
+	//C0 counts from here so both paths time the checksum below and the clock switch the same way. The CPU runs
+	//from the 2MHz RC oscillator out of reset, a prescaler of 4 gives the same 2us ticks as the event timer at 32MHz
+	//until setup_C0_eventTimer() sets its own prescaler
+	TCC0_PER = 0xFFFF;
+	TCC0_CTRLA = 0x03;
+	
+	uint8_t cause = RST.STATUS;
+	
+	RST.STATUS = cause;
+	
+	//stats don't survive a power on either
+	if((cause & RST_PORF_bm) || restartStats.magic != RESTART_STATS_MAGIC)
+	{
+		restartStats.restarts[RESTART_COLD] = 0;
+		restartStats.restarts[RESTART_WARM] = 0;
+		restartStats.first_move_ticks[RESTART_COLD] = 0;
+		restartStats.first_move_ticks[RESTART_WARM] = 0;
+		restartStats.magic = RESTART_STATS_MAGIC;
+	}
+	
+	restartPath = RESTART_COLD;
+	
+#if WARM_RESTART
+	if((cause & RST_BORF_bm) && !(cause & RST_PORF_bm) && warmState.magic == RESTART_MAGIC && warmState.crc == warm_state_crc())
+	{
+		restartPath = RESTART_WARM;
+	}
+#endif
+	
+	//only restore a snapshot once
+	warmState.magic = 0;
+	
+	restartStats.reset_cause = cause;
+	restartStats.path = restartPath;
+	restartStats.restarts[restartPath]++;
+	restartStats.first_move_ticks[restartPath] = 0;
+	
+	restartTicks = 0;
+	restartLastTimestamp = 0;
+	restartMoved = 0;
+	
+	return restartPath;
+}
+
+//copies the saved state back, used instead of initialize_motorControl(), initialize_threat_distances() and reset_infSens()
+void restart_restore()
+{
+	uint8_t moving = 0;
+	
+	copy_bytes(&motorControl, &warmState.motorControl, sizeof(motorControl));
+	copy_bytes(&infrResults, &warmState.infrResults, sizeof(infrResults));
+	copy_bytes(&threatTrack, &warmState.threatTrack, sizeof(threatTrack));
+	copy_bytes(threat_distance, warmState.threat_distance, sizeof(warmState.threat_distance));
+	closestThreat = warmState.closestThreat;
+	furthestThreat = warmState.furthestThreat;
+	headingDwell = warmState.headingDwell;
+	state = warmState.state;
+	
+	//the PWM was reset to 0, restart every motor from a standstill through the ramp
+	for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+	{
+		motorControl.current_ticks[ch] = 0;
+		motorControl.start_wait[ch] = MOTOR_START_IDLE;
+		if(motorControl.target_ticks[ch]) moving = 1;
+	}
+	
+	motorControl.speed_ticks = 0;
+	motorControl.brake_periods = 0;
+	motorControl.ramp_busy = moving || motorControl.direction_pending;
+	
+	//a brake was cut short so put back the phases it was going to restore
+	motorControl.phase = warmState.phase;
+	PORTD_OUT = warmState.phase;
+	
+	if(moving) restart_first_move();
+}
+
+//saves the state, called by main after every batch of events. changed is 0 when none of the events did anything,
+//then unless an ISR has marked the state dirty since the last copy it is still good and the copy is skipped
+void restart_checkpoint(uint8_t changed)
+{
+	restart_clock_update();
+	
+#if WARM_RESTART
+	if(!changed && !restartDirty && warmState.magic == RESTART_MAGIC) return;
+	
+	warmState.magic = 0;
+	
+	//copy with interrupts off so the ramp and reflex ISRs can't change anything half way through
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		restartDirty = 0;
+		
+		copy_bytes(&warmState.motorControl, &motorControl, sizeof(motorControl));
+		copy_bytes(&warmState.infrResults, &infrResults, sizeof(infrResults));
+		copy_bytes(&warmState.threatTrack, &threatTrack, sizeof(threatTrack));
+		copy_bytes(warmState.threat_distance, threat_distance, sizeof(warmState.threat_distance));
+		warmState.closestThreat = closestThreat;
+		warmState.furthestThreat = furthestThreat;
+		warmState.headingDwell = headingDwell;
+		warmState.state = state;
+		warmState.phase = motorControl.brake_periods ? motorControl.brake_phase : motorControl.phase;
+	}
+	
+	warmState.crc = warm_state_crc();
+	warmState.magic = RESTART_MAGIC;
+#endif
+}
+
+//called by the motor functions whenever they are told to move, records the time from reset to the first one
+void restart_first_move()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if(!restartMoved)
+		{
+			restartMoved = 1;
+			restart_clock_update();
+			restartStats.first_move_ticks[restartPath] = restartTicks ? restartTicks : 1;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * restart.h
+ *
+ * Created: 10/17/2026 5:41:52 PM
+ *  Author: Clint
+ */
+
+
+#ifndef RESTART_H_
+#define RESTART_H_
+
+#include <avr/io.h>
+#include "motor_control.h"
+#include "sensors.h"
+
+//set to 1 to pick up where the robot left off after a brown out instead of starting from scratch
+#ifndef WARM_RESTART
+#define WARM_RESTART 1
+#endif
+
+#define RESTART_COLD 0
+#define RESTART_WARM 1
+
+//changes whenever the layout of the saved state changes so an old snapshot is never restored by new firmware
+#define RESTART_MAGIC (0xB500 ^ sizeof(struct warmState_t))
+#define RESTART_STATS_MAGIC 0x5A17
+
+//copy of everything needed to carry on escaping, kept in .noinit RAM which a brown out doesn't clear.
+//main saves it after every batch of events that changed anything, or after an ISR marked it dirty, and a warm restart
+//restores it if the checksum is good
+struct warmState_t
+{
+	struct motorControl_t motorControl;
+	struct infrResults_t infrResults;
+	struct threatTrack_t threatTrack;
+	uint16_t threat_distance[4];
+	uint8_t closestThreat;
+	uint8_t furthestThreat;
+	uint8_t headingDwell;
+	uint8_t state;
+	
+	//motorControl.phase when the state was saved, the motor phases the robot was driving with
+	uint8_t phase;
+	
+	uint16_t magic;
+	uint16_t crc;
+	
+};
+
+//also in .noinit so both restart paths can be compared, read these with the debugger
+struct restartStats_t
+{
+	//RST.STATUS and the path taken at the last reset
+	uint8_t reset_cause;
+	uint8_t path;
+	
+	//resets taken down each path
+	uint16_t restarts[2];
+	
+	//time from reset to the first motor command that moves the robot on the last restart down each path,
+	//in C0 ticks (2us) counted from restart_begin() at the start of main, before the clock is switched, so both paths
+	//include the checksum and the clock start up. 0 until the robot has moved
+	uint32_t first_move_ticks[2];
+	
+	uint16_t magic;
+	
+};
+
+//set when an ISR (the reflex or the ramp) changes the saved state without posting an event, so main still
+//checkpoints it after a batch of events that changed nothing themselves
+extern volatile uint8_t restartDirty;
+#define RESTART_MARK_DIRTY() (restartDirty = 1)
+
+uint8_t restart_begin();
+void restart_restore();
+void restart_checkpoint(uint8_t changed);
+void restart_first_move();
+
+
+#endif /* RESTART_H_ */
@@ -6,44 +6,58 @@
  *
  *	Also see adc.c for interrupts related to adc conversion completion
  *	
- *	The infrared sensors are set up to measure every 100ms and after 4 measurements, the 5th time through
- *	unlocks the measurements complete semaphores so that main can determine the threat direction and where
- *	the bot should travel. 
+ *	The infrared sensors are set up to measure every 100ms. Each measurement is added to a sliding window
+ *	(or exponential moving average) for its sensor and EVENT_SWEEP_DONE is posted, so main gets an
+ *	updated threat distance after every sweep instead of waiting for a full window.
  *
  *  100ms			200ms			300ms			400ms			500ms
- *	measure			measure			measure			measure			unblock semaphores and calculate average, then start over.
+ *	measure			measure			measure			measure			measure
+ *	update avg		update avg		update avg		update avg		update avg (oldest measurement drops out)
  */ 
 #include "sensors.h"
+#include "threat_led_lut.h"
 #include "led_definitions.h"
 #include "direction_defs.h"
+#include "profile.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#if THREAT_LED_USE_SIGMOID
+#include <math.h>
+#endif
 
 //global variable declared in escape_robot.c
 extern uint16_t threat_distance[4];
 
 struct infrResults_t;
-extern struct infrResults_t infrResults;	//global structure that is used to hold measurement results
+extern struct threatTrack_t threatTrack;
+extern volatile struct infrResults_t infrResults;	//global structure that is used to hold measurement results
 
 //D1 is used to tell ADCB to do a conversion aka tells all the sensors to take a measurement
+//the overflow is routed to ADCB through event channel 1 so the sweep starts in hardware with no ISR
+//(channels 0, 2 and 4 are kept for the quadrature decoders, see encoder.c)
 void setup_timer_D1()
 {
 	//setup period for timer (with 32MHz clock and prescale 64 (5), 50000 ticks is 100ms)
-	TCD1_PER = 50000;
+	TCD1_PER = SAMPLE_PERIOD_TICKS;
 	
-	//setup signal to generate when timer overflow occurs
-	TCD1_INTCTRLA = PMIC_MEDLVLEX_bm;
+	//no interrupt needed, the overflow event starts the ADCB sweep (see setup_ADCB)
+	TCD1_INTCTRLA = 0x00;
+	
+	//send D1 overflow out on event channel 1
+	EVSYS_CH1MUX = EVSYS_CHMUX_TCD1_OVF_gc;
 	
 	//set prescaler for counter to 64 ticks
 	TCD1_CTRLA = 0x05;
 	
 }
 
-ISR(TCD1_OVF_vect)
+//changes how often the sensors take a measurement (50000 ticks is 100ms), can be called at any time
+//the buffered period is loaded on the next overflow so the current sample period is not cut short
+void set_sample_period(uint16_t ticks)
 {
-	//tell ADCB to perform conversions on all channels 0 to 3 (infrared sensors)
-	ADCB_CTRLA |= 0x3C;
-
+	TCD1_PERBUF = ticks;
 }
 
 //D0 is used to control threat direction and level LED periods, used during debugging to give visualization for what
@@ -82,20 +96,46 @@ void initialize_threat_distances()
 	threat_distance[BACK] = 0;
 }
 
-//used for setting LED PWM period during debugging
+#if THREAT_LED_USE_SIGMOID
+//used for setting LED PWM period during debugging, kept to compare against threat_led_ticks()
 double calculate_sigmoid(uint16_t sensor_value)
 {
 	double converted_value = (double)sensor_value;
 	return 1/sqrt(1+pow((double)converted_value, 2));
 }
+#endif
+
+//converts a 12 bit sensor measurement to a TCD0 compare value using the flash table in threat_led_lut.h
+//the low bits of the measurement interpolate between table entries as a Q0.THREAT_LED_LUT_SHIFT fraction
+uint16_t threat_led_ticks(uint16_t sensor_value)
+{
+	uint8_t i = sensor_value >> THREAT_LED_LUT_SHIFT;
+	uint8_t frac = sensor_value & ((1 << THREAT_LED_LUT_SHIFT) - 1);
+	
+	//filtered values can't exceed 12 bits, but make sure the table is never read past the end
+	if (i >= THREAT_LED_LUT_SIZE - 1) return pgm_read_word(&threatLedLut[THREAT_LED_LUT_SIZE - 1]);
+	
+	uint16_t lower = pgm_read_word(&threatLedLut[i]);
+	uint16_t upper = pgm_read_word(&threatLedLut[i + 1]);
+	
+	//table is decreasing so step down from the lower entry
+	return lower - (uint16_t)(((uint32_t)(lower - upper) * frac) >> THREAT_LED_LUT_SHIFT);
+}
 
 //used for debugging sensors
 void set_threatLevel_to_TCD0_CCx()
 {
+#if THREAT_LED_USE_SIGMOID
 	TCD0_CCA = (uint16_t)(calculate_sigmoid(threat_distance[LEFT]) * MAX_TICKS_THREAT_LED * 500);
 	TCD0_CCB = (uint16_t)(calculate_sigmoid(threat_distance[FRONT]) * MAX_TICKS_THREAT_LED * 500);
 	TCD0_CCC = (uint16_t)(calculate_sigmoid(threat_distance[BACK]) * MAX_TICKS_THREAT_LED * 500);
 	TCD0_CCD = (uint16_t)(calculate_sigmoid(threat_distance[RIGHT]) * MAX_TICKS_THREAT_LED *  500);
+#else
+	TCD0_CCA = threat_led_ticks(threat_distance[LEFT]);
+	TCD0_CCB = threat_led_ticks(threat_distance[FRONT]);
+	TCD0_CCC = threat_led_ticks(threat_distance[BACK]);
+	TCD0_CCD = threat_led_ticks(threat_distance[RIGHT]);
+#endif
 }
 
 //Interrupts used for setting threat measurements from infrared sensors to lower nibble of LED port
@@ -103,103 +143,180 @@ void set_threatLevel_to_TCD0_CCx()
 //D0 used to control threat level LEDs (4 lsb)
 ISR(TCD0_OVF_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_TCD0_OVF);
 	//turn on all of the LEDs used on so that CCA, CCB, CCC, CCD can turn them off
 	LED_PORT.OUT |= 0x0F;
+	PROFILE_ISR_EXIT(PROFILE_TCD0_OVF);
 }
 
 ISR(TCD0_CCA_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_TCD0_CCA);
 	//turn off left moving LED
 	LED_PORT.OUT &= (~LED_THREAT_LEFT);
+	PROFILE_ISR_EXIT(PROFILE_TCD0_CCA);
 }
 
 ISR(TCD0_CCB_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_TCD0_CCB);
 	//turn off front moving LED
 	LED_PORT.OUT &= (~LED_THREAT_FORWARD);
+	PROFILE_ISR_EXIT(PROFILE_TCD0_CCB);
 }
 
 ISR(TCD0_CCC_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_TCD0_CCC);
 	//turn off back moving LED
 	LED_PORT.OUT &= (~LED_THREAT_BACKWARD);
+	PROFILE_ISR_EXIT(PROFILE_TCD0_CCC);
 }
 
 ISR(TCD0_CCD_vect)
 {
+	PROFILE_ISR_ENTER(PROFILE_TCD0_CCD);
 	//turn off right moving LED
 	LED_PORT.OUT &= (~LED_THREAT_RIGHT);
+	PROFILE_ISR_EXIT(PROFILE_TCD0_CCD);
 }
 
 
-//called by main to calculate the average threat distance measured by sensors every 500ms
+//called by main to copy the filtered threat distance measured by the sensors after every sweep
 void set_infrSens_avg_to_threatDist()
 {
 	threat_distance[LEFT] = calc_avg(LEFT);
 	threat_distance[RIGHT] = calc_avg(RIGHT);
 	threat_distance[FRONT] = calc_avg(FRONT);
 	threat_distance[BACK] = calc_avg(BACK);
+	
+	update_threat_trackers();
 }
 
+//runs one alpha-beta step for each sensor on the latest threat distances, called once per sweep
+void update_threat_trackers()
+{
+	for (uint8_t dir = LEFT; dir <= RIGHT; dir++)
+	{
+		int16_t measured = (int16_t)(threat_distance[dir] << TRACK_Q_SHIFT);
+		
+		if (!threatTrack.started)
+		{
+			threatTrack.distance[dir] = measured;
+			threatTrack.rate[dir] = 0;
+		}
+		else
+		{
+			//predict where the threat is now and correct by a fraction of the difference to the measurement
+			int32_t predicted = (int32_t)threatTrack.distance[dir] + threatTrack.rate[dir];
+			int32_t residual = measured - predicted;
+			int32_t rate = threatTrack.rate[dir] + (residual >> TRACK_BETA_SHIFT);
+			
+			predicted += residual >> TRACK_ALPHA_SHIFT;
+			
+			if (predicted < 0) predicted = 0;
+			else if (predicted > TRACK_MAX_DISTANCE) predicted = TRACK_MAX_DISTANCE;
+			
+			if (rate < -TRACK_MAX_DISTANCE) rate = -TRACK_MAX_DISTANCE;
+			else if (rate > TRACK_MAX_DISTANCE) rate = TRACK_MAX_DISTANCE;
+			
+			threatTrack.distance[dir] = (int16_t)predicted;
+			threatTrack.rate[dir] = (int16_t)rate;
+		}
+	}
+	
+	threatTrack.started = 1;
+}
 
-//calculates average of sensor measurements based on the direction passed
-//threat measurements are stored in arrays in infResults structure
+//returns the number of sweeps until the threat in this direction reaches CONTACT_INFRARED,
+//0 if it is already there and TTC_NEVER if it isn't getting closer
+uint16_t time_to_contact(uint8_t direction)
+{
+	int16_t remaining = (CONTACT_INFRARED << TRACK_Q_SHIFT) - threatTrack.distance[direction];
+	int16_t rate = threatTrack.rate[direction];
+	
+	if (remaining <= 0) return 0;
+	if (rate <= TRACK_MIN_RATE) return TTC_NEVER;
+	
+	return (uint16_t)(remaining / rate);
+}
+
+
+//returns the filtered measurement for the direction passed, the running sum makes this O(1)
 uint16_t calc_avg(uint8_t direction)
 {
-	int sum = 0;
+	uint16_t sum;
+	uint8_t count;
 	
-	switch(direction)
+	//the ADC ISRs can update the filter while it is being read
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		case LEFT:
-		
-			for (int i = 0; i < NUM_INF_SENS_MEAS; i++)
-			{
-				sum += infrResults.left[i];
-			}
-		
-			break;
-		
-		case FRONT:
-		
-			for (int i = 0; i < NUM_INF_SENS_MEAS; i++)
-			{
-				sum += infrResults.front[i];
-			}
-		
-			break;
-		
-		case BACK:
-		
-			for (int i = 0; i < NUM_INF_SENS_MEAS; i++)
-			{
-				sum += infrResults.back[i];
-			}
-		
-			break;
-		
-		case RIGHT:
-		
-			for (int i = 0; i < NUM_INF_SENS_MEAS; i++)
-			{
-				sum += infrResults.right[i];
-			}
-		
-			break;	
-		
-	}	
+		sum = infrResults.sum[direction];
+		count = infrResults.count[direction];
+	}
+	
+	if (count == 0) return 0;
+	
+#if INF_SENS_USE_EMA
+	return sum >> INF_SENS_EMA_SHIFT;
+#else
+	//window is still filling up after a reset
+	if (count < NUM_INF_SENS_MEAS) return sum / count;
 	
 	return sum / NUM_INF_SENS_MEAS;
+#endif
 	
 }
 
-//resets the measurement count, called by main after a direction has been determined every 500ms
-void reset_infSens()
+//adds a new measurement to the filter for the direction passed, called once per sensor every sweep
+void add_infSens_meas(uint8_t direction, uint16_t measurement)
 {
-	infrResults.lCount = 0;
-	infrResults.rCount = 0;
-	infrResults.fCount = 0;
-	infrResults.bCount = 0;
+#if INF_SENS_USE_EMA
+	//start the average at the first measurement so it doesn't have to climb up from 0
+	if (infrResults.count[direction] == 0)
+	{
+		infrResults.sum[direction] = measurement << INF_SENS_EMA_SHIFT;
+		infrResults.count[direction] = 1;
+	}
+	else
+	{
+		infrResults.sum[direction] += measurement - (infrResults.sum[direction] >> INF_SENS_EMA_SHIFT);
+	}
+#else
+	uint8_t i = infrResults.index[direction];
+	
+	//swap the oldest measurement in the window for the new one
+	infrResults.sum[direction] += measurement - infrResults.window[direction][i];
+	infrResults.window[direction][i] = measurement;
+	
+	if (++i == NUM_INF_SENS_MEAS) i = 0;
+	infrResults.index[direction] = i;
+	
+	if (infrResults.count[direction] < NUM_INF_SENS_MEAS) infrResults.count[direction]++;
+#endif
 	
 }
 
-
+//empties the filters, called by main after spinning since the old measurements no longer apply
+void reset_infSens()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t dir = LEFT; dir <= RIGHT; dir++)
+		{
+#if !INF_SENS_USE_EMA
+			for (uint8_t i = 0; i < NUM_INF_SENS_MEAS; i++)
+			{
+				infrResults.window[dir][i] = 0;
+			}
+			infrResults.index[dir] = 0;
+#endif
+			infrResults.sum[dir] = 0;
+			infrResults.count[dir] = 0;
+		}
+		
+		//the trackers start again from the next sweep
+		threatTrack.started = 0;
+	}
+	
+}
@@ -15,31 +15,93 @@
 #define MIN_TICK_DELTA 50
 #define MIN_INFRARED_THREAT 400
 #define TRAPPED_INFRARED 1000
+
+//alpha-beta tracker run on each filtered sensor once per sweep. Distance and rate (per sweep) are kept in
+//1/2^TRACK_Q_SHIFT ADC counts so a 12 bit reading still fits in an int16, the gains are 1/2^TRACK_ALPHA_SHIFT
+//and 1/2^TRACK_BETA_SHIFT so the update is just adds and shifts
+#define TRACK_Q_SHIFT 3
+#define TRACK_ALPHA_SHIFT 1
+#define TRACK_BETA_SHIFT 3
+#define TRACK_MAX_DISTANCE (4095 << TRACK_Q_SHIFT)
+
+//rates at or below this (2 counts per sweep) are treated as noise rather than an approaching threat
+#define TRACK_MIN_RATE (2 << TRACK_Q_SHIFT)
+
+//reading at which a threat is considered to have reached the robot
+#define CONTACT_INFRARED TRAPPED_INFRARED
+
+//time to contact (in sweeps) for a threat that isn't getting closer
+#define TTC_NEVER 0xFFFF
+
+//start escaping a threat that will reach the robot within this many sweeps even if it is still far away
+#define ESCAPE_TTC_SWEEPS 10
+
+//default time between sensor measurements, 50000 ticks is 100ms (see setup_timer_D1)
+#define SAMPLE_PERIOD_TICKS 50000
+
+//length of the sliding window used to filter each infrared sensor (max 16 so the running sum fits in 16 bits)
+//a power of 2 lets the average be done with a shift
 #define NUM_INF_SENS_MEAS 4
 
+//set to 1 to replace the sliding window with an exponential moving average that only uses shifts
+//each new measurement gets a weight of 1/2^INF_SENS_EMA_SHIFT (max shift of 4 so the filter fits in 16 bits)
+#ifndef INF_SENS_USE_EMA
+#define INF_SENS_USE_EMA 0
+#endif
+#define INF_SENS_EMA_SHIFT 2
+
+//set to 1 to use the original floating point sigmoid for the threat LEDs instead of the flash lookup table
+#ifndef THREAT_LED_USE_SIGMOID
+#define THREAT_LED_USE_SIGMOID 0
+#endif
+
+#if NUM_INF_SENS_MEAS > 16 || INF_SENS_EMA_SHIFT > 4
+#error "infrared filter does not fit in 16 bits"
+#endif
+
 void setup_timer_D1();
+void set_sample_period(uint16_t ticks);
 void setup_timer_D0();
 void initialize_threat_distances();
 void set_threatLevel_to_TCD0_CCx();
+#if THREAT_LED_USE_SIGMOID
 double calculate_sigmoid(uint16_t sensor_value);
+#endif
+uint16_t threat_led_ticks(uint16_t sensor_value);
 void set_infrSens_avg_to_threatDist();
 uint16_t calc_avg(uint8_t direction);
+void add_infSens_meas(uint8_t direction, uint16_t measurement);
 void reset_infSens();
+void update_threat_trackers();
+uint16_t time_to_contact(uint8_t direction);
 void initialize_infSens();
 
+//all arrays are indexed by the directions in direction_defs.h
 struct infrResults_t
 {
-	uint16_t left[NUM_INF_SENS_MEAS];
-	uint16_t right[NUM_INF_SENS_MEAS];	
-	uint16_t front[NUM_INF_SENS_MEAS];	
-	uint16_t back[NUM_INF_SENS_MEAS];
-		
-	uint8_t lCount;
-	uint8_t rCount;
-	uint8_t fCount;
-	uint8_t bCount;
+#if !INF_SENS_USE_EMA
+	//ring buffer holding the latest measurements for each sensor
+	uint16_t window[4][NUM_INF_SENS_MEAS];
+	uint8_t index[4];
+#endif
+
+	//running sum of each window, or the EMA scaled by 2^INF_SENS_EMA_SHIFT
+	uint16_t sum[4];
+	
+	//number of measurements in the window, stops counting once the window is full
+	uint8_t count[4];
 	
 };
 
+//tracked distance and rate of change of each sensor, indexed by the directions in direction_defs.h
+struct threatTrack_t
+{
+	int16_t distance[4];
+	int16_t rate[4];
+	
+	//0 until the first sweep has been tracked
+	uint8_t started;
+	
+};
 
 #endif /* SENSORS_H_ */
\ No newline at end of file
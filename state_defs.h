@@ -9,11 +9,40 @@
 #ifndef STATE_DEFS_H_
 #define STATE_DEFS_H_
 
+#include <avr/io.h>
+
 //state definitions
 #define ESCAPING 0
 #define TRAPPED 1
 #define SPINNING 2
 #define TESTING 3
 
+#define NUM_STATES 4
+
+//set to 1 to record how long it takes from an event being posted to its action running,
+//and to keep a log of the last transitions the state machine made
+#ifndef SM_MEASURE_LATENCY
+#define SM_MEASURE_LATENCY 0
+#endif
+
+#define SM_TRACE_SIZE 8
+
+//latency from an event being posted to its action running, in C0 event timer ticks (2us)
+struct smLatency_t
+{
+	uint16_t last;
+	uint16_t max;
+	uint16_t count;
+};
+
+//one state machine transition, saved in the trace log
+struct smTransition_t
+{
+	uint8_t from_state;
+	uint8_t event;
+	uint8_t to_state;
+	uint16_t timestamp;
+};
+
 
 #endif /* STATE_DEFS_H_ */
\ No newline at end of file
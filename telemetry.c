@@ -0,0 +1,162 @@
+/*
+ * telemetry.c
+ *
+ * Created: 10/17/2026 8:42:03 PM
+ *  Author: Clint
+ *
+ *	Binary telemetry out of USARTC0, only built in with TELEMETRY. After every batch of events main calls
+ *	telemetry_send(), which takes a snapshot of the sensors, state and motors, adds a CRC, COBS encodes it
+ *	into telemetryTx and hands that to DMA channel 2. The channel is triggered by the USART data register
+ *	being empty, so it moves one byte each time the USART is ready for it without the CPU.
+ *
+ *	A frame is 42 bytes encoded, under 4ms at 115200 baud. If the last frame is still going out when the next
+ *	one is due the new one is dropped (and counted in telemetryDropped) rather than waiting, the gap shows
+ *	up in the sequence numbers on the receiving end.
+ */
+
+#include "telemetry.h"
+#include "motor_control.h"
+#include "events.h"
+#include "hal.h"
+#include <avr/io.h>
+#include <stddef.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+//global variables declared in escape_robot.c
+extern volatile uint16_t threat_distance[4];
+extern volatile uint8_t closestThreat;
+extern volatile uint8_t furthestThreat;
+extern volatile struct motorControl_t motorControl;
+extern volatile uint8_t state;
+
+#if TELEMETRY
+//frames that weren't sent because the DMA was still busy with the one before, read it with the debugger
+volatile uint16_t telemetryDropped = 0;
+
+static struct telemetryFrame_t telemetryFrame;
+static uint8_t telemetryTx[TELEMETRY_TX_SIZE];
+static uint8_t telemetrySeq = 0;
+
+//C0 ticks since reset, main sends a frame at least every sample period so no C0 wrap is missed
+static uint32_t telemetryTicks = 0;
+static uint16_t telemetryLastTimestamp = 0;
+
+//COBS encodes size bytes into out and ends them with the 0x00 delimiter, returns the encoded length
+static uint8_t cobs_encode(const uint8_t *data, uint8_t size, uint8_t *out)
+{
+	uint8_t code_index = 0;
+	uint8_t length = 1;
+	uint8_t code = 1;
+	
+	for(uint8_t i = 0; i < size; i++)
+	{
+		if(data[i])
+		{
+			out[length++] = data[i];
+			code++;
+		}
+		
+		//a zero, or 254 non zero bytes in a row, ends the block
+		if(!data[i] || code == 0xFF)
+		{
+			out[code_index] = code;
+			code_index = length++;
+			code = 1;
+		}
+	}
+	
+	out[code_index] = code;
+	out[length++] = 0;
+	
+	return length;
+}
+
+//fills telemetryFrame in with interrupts off so the ramp and reflex ISRs can't change anything half way through
+static void telemetry_snapshot()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint16_t now = event_timestamp();
+		
+		telemetryTicks += (uint16_t)(now - telemetryLastTimestamp);
+		telemetryLastTimestamp = now;
+		
+		telemetryFrame.timestamp = telemetryTicks;
+		
+		for(uint8_t i = 0; i < 4; i++) telemetryFrame.threat_distance[i] = threat_distance[i];
+		
+		telemetryFrame.state = state;
+		telemetryFrame.direction = (uint8_t)motorControl.direction;
+		telemetryFrame.phase = PORTD_OUT & MOTOR_PHASE_MASK;
+		telemetryFrame.threat_order = (uint8_t)(closestThreat | (furthestThreat << 4));
+		telemetryFrame.speed_ticks = (uint16_t)motorControl.speed_ticks;
+		telemetryFrame.target_speed_ticks = (uint16_t)motorControl.target_speed_ticks;
+		
+		for(uint8_t ch = 0; ch < NUM_MOTORS; ch++)
+		{
+			telemetryFrame.target_ticks[ch] = motorControl.target_ticks[ch];
+			telemetryFrame.current_ticks[ch] = motorControl.current_ticks[ch];
+		}
+	}
+}
+#endif
+
+//USARTC0 transmits on PC3, DMA channel 2 feeds it. Must be called after setup_DMA_ADCB(), which resets the DMA controller
+void setup_USARTC0_telemetry()
+{
+#if TELEMETRY
+	//TXD0 idles high
+	PORTC.OUTSET = 0x08;
+	PORTC.DIRSET = 0x08;
+	
+	USARTC0.BAUDCTRLA = (uint8_t)TELEMETRY_BSEL;
+	USARTC0.BAUDCTRLB = (uint8_t)(((TELEMETRY_BSCALE & 0x0F) << USART_BSCALE_gp) | (TELEMETRY_BSEL >> 8));
+	USARTC0.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_PMODE_DISABLED_gc | USART_CHSIZE_8BIT_gc;
+	USARTC0.CTRLB = USART_TXEN_bm;
+	
+	//one byte per trigger, the source steps through telemetryTx and the destination is always the USART data register.
+	//The channel turns itself off at the end of the frame, there is no interrupt
+	DMA.CH2.CTRLA = DMA_CH_BURSTLEN_1BYTE_gc | DMA_CH_SINGLE_bm;
+	DMA.CH2.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_INC_gc | DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+	DMA.CH2.TRIGSRC = DMA_CH_TRIGSRC_USARTC0_DRE_gc;
+	DMA.CH2.CTRLB = 0;
+	HAL_DMA_DESTADDR(&DMA.CH2, &USARTC0.DATA);
+	
+	//in ISR mode setup_DMA_ADCB() leaves the controller off
+	DMA.CTRL |= DMA_ENABLE_bm;
+	
+	telemetryLastTimestamp = event_timestamp();
+#endif
+}
+
+//called by main after every batch of events, never waits for the USART
+void telemetry_send()
+{
+#if TELEMETRY
+	//the DMA is still reading telemetryTx
+	if(DMA.CH2.CTRLA & DMA_CH_ENABLE_bm)
+	{
+		telemetryDropped++;
+		return;
+	}
+	
+	telemetry_snapshot();
+	
+	telemetryFrame.type = TELEMETRY_FRAME_STATUS;
+	telemetryFrame.seq = telemetrySeq++;
+	
+	const uint8_t *data = (const uint8_t *)&telemetryFrame;
+	uint16_t crc = 0xFFFF;
+	
+	for(uint8_t i = 0; i < offsetof(struct telemetryFrame_t, crc); i++) crc = _crc_ccitt_update(crc, data[i]);
+	telemetryFrame.crc = crc;
+	
+	uint8_t length = cobs_encode(data, sizeof(telemetryFrame), telemetryTx);
+	
+	DMA.CH2.CTRLB |= DMA_CH_TRNIF_bm;
+	DMA.CH2.TRFCNT = length;
+	HAL_DMA_SRCADDR(&DMA.CH2, telemetryTx);
+	DMA.CH2.CTRLA |= DMA_CH_ENABLE_bm;
+#endif
+}
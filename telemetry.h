@@ -0,0 +1,71 @@
+/*
+ * telemetry.h
+ *
+ * Created: 10/17/2026 8:41:17 PM
+ *  Author: Clint
+ */
+
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <avr/io.h>
+#include "motor_control.h"
+
+//set to 1 to send a telemetry frame out of USARTC0 (TXD0 on PC3) after every batch of events.
+//The bytes are fed to the USART by DMA channel 2 so main never waits for the serial port. The host build turns it on
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+//115200 baud 8N1 from the 32MHz peripheral clock, BSEL 1047 with BSCALE -6 is 0.01% off
+#define TELEMETRY_BSEL 1047
+#define TELEMETRY_BSCALE -6
+
+//first byte of every frame, changes whenever the layout of telemetryFrame_t changes
+#define TELEMETRY_FRAME_STATUS 0x01
+
+//one snapshot of the robot, sent little endian as it is in memory. The CRC is CRC-CCITT (0x8408 reflected,
+//starting at 0xFFFF) of all the bytes before it, then the whole frame is COBS encoded and ended with a 0x00
+//so a receiver can find the start of the next frame after losing bytes. tools/telemetry_decode.py reads it
+struct telemetryFrame_t
+{
+	uint8_t type;
+	
+	//counts up by one every frame sent, a gap means frames were dropped because the last one was still going out
+	uint8_t seq;
+	
+	//C0 ticks (2us) since reset, wraps after 2.4 hours
+	uint32_t timestamp;
+	
+	//filtered sensor readings, LEFT, FRONT, BACK, RIGHT
+	uint16_t threat_distance[4];
+	
+	uint8_t state;
+	
+	//motorControl.direction and the phases the H-bridges are driven with (PORTD_OUT)
+	uint8_t direction;
+	uint8_t phase;
+	
+	//what is shown on the LEDs, closestThreat | furthestThreat << 4
+	uint8_t threat_order;
+	
+	uint16_t speed_ticks;
+	uint16_t target_speed_ticks;
+	
+	//per motor PWM duty the ramp is heading for and the duty it is at, in NUM_MOTORS order (LF, LR, RR, RF)
+	uint16_t target_ticks[NUM_MOTORS];
+	uint16_t current_ticks[NUM_MOTORS];
+	
+	uint16_t crc;
+	
+} __attribute__((packed));
+
+//COBS adds one byte per 254 and the delimiter
+#define TELEMETRY_TX_SIZE (sizeof(struct telemetryFrame_t) + sizeof(struct telemetryFrame_t) / 254 + 2)
+
+void setup_USARTC0_telemetry();
+void telemetry_send();
+
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,40 @@
+/*
+ * threat_led_lut.h
+ *
+ * Generated by tools/gen_threat_led_lut.py, do not edit.
+ *
+ *	TCD0 compare values for the threat level LEDs, indexed by ADC reading >> THREAT_LED_LUT_SHIFT
+ */ 
+
+
+#ifndef THREAT_LED_LUT_H_
+#define THREAT_LED_LUT_H_
+
+#include <avr/pgmspace.h>
+
+#define THREAT_LED_LUT_SHIFT 5
+#define THREAT_LED_LUT_SIZE 129
+
+static const uint16_t threatLedLut[THREAT_LED_LUT_SIZE] PROGMEM =
+{
+	60000, 60000, 60000, 60000, 60000, 60000, 60000, 60000,
+	60000, 60000, 60000, 60000, 60000, 60000, 60000, 60000,
+	58594, 55147, 52083, 49342, 46875, 44643, 42614, 40761,
+	39062, 37500, 36058, 34722, 33482, 32328, 31250, 30242,
+	29297, 28409, 27574, 26786, 26042, 25338, 24671, 24038,
+	23437, 22866, 22321, 21802, 21307, 20833, 20380, 19947,
+	19531, 19133, 18750, 18382, 18029, 17689, 17361, 17045,
+	16741, 16447, 16164, 15890, 15625, 15369, 15121, 14881,
+	14648, 14423, 14205, 13993, 13787, 13587, 13393, 13204,
+	13021, 12842, 12669, 12500, 12336, 12175, 12019, 11867,
+	11719, 11574, 11433, 11295, 11161, 11029, 10901, 10776,
+	10653, 10534, 10417, 10302, 10190, 10081,  9973,  9868,
+	 9766,  9665,  9566,  9470,  9375,  9282,  9191,  9102,
+	 9014,  8929,  8844,  8762,  8681,  8601,  8523,  8446,
+	 8371,  8296,  8224,  8152,  8082,  8013,  7945,  7878,
+	 7812,  7748,  7684,  7622,  7560,  7500,  7440,  7382,
+	 7324,
+};
+
+
+#endif /* THREAT_LED_LUT_H_ */
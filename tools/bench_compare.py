@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+#
+# bench_compare.py
+#
+# Compares two bench_results.tsv files written by bench/Makefile, usually one from an older commit
+# against the current one:
+#
+#     python tools/bench_compare.py old/bench_results.tsv bench/bench_results.tsv
+#
+# Prints the average cycles (or bytes for the flash and sram rows) of every routine in both, with the
+# change. Rows only in one of the files are shown with a - for the other.
+#
+# bench_results_host.tsv from make host has min_ns, avg_ns and max_ns columns instead, host nanoseconds.
+# Two host files can be compared with each other but never with a file of cycle counts.
+
+import sys
+
+
+def read_results(path):
+    results = {}
+    with open(path) as f:
+        header = f.readline().rstrip("\n").split("\t")
+        unit = "host ns" if "avg_ns" in header else "cycles"
+        avg = "avg_ns" if unit == "host ns" else "avg"
+        for line in f:
+            row = dict(zip(header, line.rstrip("\n").split("\t")))
+            results[(row["config"], row["name"])] = int(row[avg])
+    return unit, results
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: bench_compare.py <base.tsv> <new.tsv>")
+
+    base_unit, base = read_results(sys.argv[1])
+    new_unit, new = read_results(sys.argv[2])
+    if base_unit != new_unit:
+        sys.exit("can't compare %s in %s with %s in %s" % (base_unit, sys.argv[1], new_unit, sys.argv[2]))
+
+    print("averages in %s (bytes for flash and sram)" % new_unit)
+    print("%-12s %-32s %8s %8s %8s %7s" % ("config", "name", "base", "new", "change", "%"))
+    for key in sorted(set(base) | set(new)):
+        old_value = base.get(key)
+        new_value = new.get(key)
+        if old_value is None or new_value is None:
+            print("%-12s %-32s %8s %8s" % (key[0], key[1], old_value if old_value is not None else "-",
+                                           new_value if new_value is not None else "-"))
+            continue
+        change = new_value - old_value
+        percent = 100.0 * change / old_value if old_value else 0.0
+        print("%-12s %-32s %8d %8d %+8d %+6.1f%%" % (key[0], key[1], old_value, new_value, change, percent))
+
+
+if __name__ == "__main__":
+    main()
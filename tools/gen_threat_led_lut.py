@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# gen_threat_led_lut.py
+#
+# Generates threat_led_lut.h, the flash lookup table used by threat_led_ticks() in sensors.c.
+# Run from the project directory whenever MAX_TICKS_THREAT_LED, MIN_TICK_DELTA or the table size change:
+#
+#     python tools/gen_threat_led_lut.py
+#
+# Each entry is the TCD0 compare value for one ADC reading, using the same curve as the old
+# floating point routine: MAX_TICKS_THREAT_LED * 500 / sqrt(1 + x^2), limited to the timer period.
+
+import math
+import os
+import re
+
+PROJECT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+# table has 2^(12 - THREAT_LED_LUT_SHIFT) + 1 entries, the extra one is used to interpolate the last segment
+THREAT_LED_LUT_SHIFT = 5
+ADC_BITS = 12
+
+
+def read_define(header, name):
+    with open(os.path.join(PROJECT_DIR, header)) as f:
+        match = re.search(r"#define\s+%s\s+(\d+)" % name, f.read())
+    return int(match.group(1))
+
+
+def main():
+    max_ticks = read_define("sensors.h", "MAX_TICKS_THREAT_LED")
+    min_ticks = read_define("sensors.h", "MIN_TICK_DELTA")
+    scale = max_ticks * 500
+
+    entries = (1 << (ADC_BITS - THREAT_LED_LUT_SHIFT)) + 1
+    values = []
+    for i in range(entries):
+        x = i << THREAT_LED_LUT_SHIFT
+        ticks = int(round(scale / math.sqrt(1 + x * x)))
+        values.append(min(max_ticks, max(min_ticks, ticks)))
+
+    lines = []
+    for i in range(0, entries, 8):
+        lines.append("\t" + ", ".join("%5d" % v for v in values[i:i + 8]) + ",")
+
+    with open(os.path.join(PROJECT_DIR, "threat_led_lut.h"), "w") as f:
+        f.write("/*\n")
+        f.write(" * threat_led_lut.h\n")
+        f.write(" *\n")
+        f.write(" * Generated by tools/gen_threat_led_lut.py, do not edit.\n")
+        f.write(" *\n")
+        f.write(" *\tTCD0 compare values for the threat level LEDs, indexed by ADC reading >> THREAT_LED_LUT_SHIFT\n")
+        f.write(" */ \n\n\n")
+        f.write("#ifndef THREAT_LED_LUT_H_\n#define THREAT_LED_LUT_H_\n\n")
+        f.write("#include <avr/pgmspace.h>\n\n")
+        f.write("#define THREAT_LED_LUT_SHIFT %d\n" % THREAT_LED_LUT_SHIFT)
+        f.write("#define THREAT_LED_LUT_SIZE %d\n\n" % entries)
+        f.write("static const uint16_t threatLedLut[THREAT_LED_LUT_SIZE] PROGMEM =\n{\n")
+        f.write("\n".join(lines) + "\n};\n\n\n")
+        f.write("#endif /* THREAT_LED_LUT_H_ */\n")
+
+
+if __name__ == "__main__":
+    main()
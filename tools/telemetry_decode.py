@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+#
+# telemetry_decode.py
+#
+# Turns the binary telemetry stream the firmware sends out of USARTC0 (see telemetry.c) into CSV:
+#
+#     python tools/telemetry_decode.py /dev/ttyUSB0 > run.csv      (needs pyserial)
+#     python tools/telemetry_decode.py capture.bin -o run.csv
+#     host/escape_robot_host -q -T - | python tools/telemetry_decode.py
+#
+# Frames are COBS encoded and end with a 0x00, so decoding starts cleanly at the first delimiter even when
+# the capture begins part way through a frame. Frames with a bad CRC, the wrong length or an unknown type
+# are skipped. The timestamp is unwrapped and printed in microseconds. A summary with the frames decoded,
+# rejected and missing (from gaps in the sequence numbers) is printed to stderr at the end.
+
+import argparse
+import struct
+import sys
+
+# struct telemetryFrame_t in telemetry.h, little endian and packed
+FRAME_FORMAT = "<BBI4HBBBBHH4H4HH"
+FRAME_SIZE = struct.calcsize(FRAME_FORMAT)
+FRAME_STATUS = 0x01
+
+# C0 ticks are 2us and the timestamp is 32 bits
+TICK_US = 2
+TIMESTAMP_WRAP = 1 << 32
+
+STATES = ["escaping", "trapped", "spinning", "testing"]
+DIRECTIONS = ["left", "front", "back", "right"]
+
+COLUMNS = ["time_us", "seq", "state", "direction", "phase", "closest", "furthest",
+           "left", "front", "back", "right", "speed", "target_speed",
+           "target_lf", "target_lr", "target_rr", "target_rf",
+           "current_lf", "current_lr", "current_rr", "current_rf"]
+
+
+def crc_ccitt(data):
+    # _crc_ccitt_update from avr-libc, 0x8408 reflected starting at 0xFFFF
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        # a full block of 254 bytes isn't followed by a zero
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def name(names, value):
+    return names[value] if value < len(names) else str(value)
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.buffer = bytearray()
+        self.synced = False
+        self.frames = 0
+        self.rejected = 0
+        self.missing = 0
+        self.last_seq = None
+        self.last_timestamp = None
+        self.time_us = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(0)
+            if end < 0:
+                return
+            encoded = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            # what comes before the first delimiter is usually the end of a frame we missed the start of,
+            # it isn't counted as rejected if it doesn't decode
+            if not self.frame(encoded) and self.synced:
+                self.rejected += 1
+            self.synced = True
+
+    def frame(self, encoded):
+        frame = cobs_decode(encoded)
+        if (frame is None or len(frame) != FRAME_SIZE or frame[0] != FRAME_STATUS or
+                crc_ccitt(frame[:-2]) != struct.unpack_from("<H", frame, FRAME_SIZE - 2)[0]):
+            return False
+
+        fields = struct.unpack(FRAME_FORMAT, frame)
+        seq, timestamp = fields[1], fields[2]
+        distances = fields[3:7]
+        state, direction, phase, threat_order = fields[7:11]
+        speed, target_speed = fields[11:13]
+        target_ticks = fields[13:17]
+        current_ticks = fields[17:21]
+
+        if self.last_seq is not None:
+            self.missing += (seq - self.last_seq - 1) & 0xFF
+            self.time_us += ((timestamp - self.last_timestamp) % TIMESTAMP_WRAP) * TICK_US
+        else:
+            self.time_us = timestamp * TICK_US
+        self.last_seq = seq
+        self.last_timestamp = timestamp
+        self.frames += 1
+
+        row = [self.time_us, seq, name(STATES, state), name(DIRECTIONS, direction), "0x%X" % phase,
+               name(DIRECTIONS, threat_order & 0x0F), name(DIRECTIONS, threat_order >> 4)]
+        row += list(distances) + [speed, target_speed] + list(target_ticks) + list(current_ticks)
+        self.out.write(",".join(str(value) for value in row) + "\n")
+        return True
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode the firmware telemetry stream to CSV")
+    parser.add_argument("input", nargs="?", default="-", help="capture file, serial port or - for stdin (default)")
+    parser.add_argument("-o", "--output", help="CSV file to write (default stdout)")
+    parser.add_argument("-b", "--baud", type=int, default=115200, help="serial port baud rate (default 115200)")
+    args = parser.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    out.write(",".join(COLUMNS) + "\n")
+    decoder = Decoder(out)
+    source = open_input(args.input, args.baud)
+
+    try:
+        while True:
+            data = source.read(4096)
+            if not data:
+                # a serial port times out with nothing to read, carry on until interrupted
+                if hasattr(source, "in_waiting"):
+                    continue
+                break
+            decoder.feed(data)
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+
+    sys.stderr.write("%d frames, %d rejected, %d missing\n" % (decoder.frames, decoder.rejected, decoder.missing))
+
+
+if __name__ == "__main__":
+    main()